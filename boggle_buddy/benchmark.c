@@ -0,0 +1,211 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "problem.h"
+#include "dictionary.h"
+#include "boggle.h"
+
+/* Board sizes benchmarked, from a standard board up to 200x200. */
+static const int boardSizes[] = {4, 8, 16, 32, 64, 100, 200};
+#define BOARD_SIZE_COUNT (sizeof(boardSizes) / sizeof(boardSizes[0]))
+
+/* Letters sampled for the board with their English frequencies, in
+   hundredths of a percent. */
+static const char boardLetters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+static const int letterFrequencies[] = {
+    817, 149, 278, 425, 1270, 223, 202, 609, 697, 15, 77, 403, 241,
+    675, 751, 193, 10,  599, 633,  906, 276, 98,  236, 15, 197, 7};
+
+/* Returns the next value of a xorshift generator, so boards only depend on
+   the seed and not on the C library. */
+unsigned long long nextRandom(unsigned long long *state);
+
+/* Generates a random board of the given dimension. */
+char **generateBoard(int dimension, unsigned long long *state);
+
+/* Spells a random partial word of the given length along a board path. */
+char *randomBoardPrefix(char **board, int dimension, int length,
+                        unsigned long long *state);
+
+/* Returns the elapsed time between two timestamps in milliseconds. */
+double elapsedMs(struct timespec *start, struct timespec *end);
+
+/* Frees a solution returned by one of the search functions. */
+void freeSolution(struct solution *s);
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s dictionary.txt [seed [dictionary.trie]]\n",
+                argv[0]);
+        return 1;
+    }
+    unsigned long long seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+    unsigned long long state = seed ? seed : 1;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    struct dictionary *d = loadDictionary(argv[1]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (d == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    printf("dictionary: %d words, %d trie nodes, %lld trie bytes, "
+           "loaded in %.2f ms\n",
+           d->wordCount, d->nodeCount,
+           (long long)d->nodeCount * (long long)sizeof(struct trieNode),
+           elapsedMs(&start, &end));
+
+    /* With a trie path, save the trie and search it from its mapping. */
+    struct dictionary *searched = d;
+    if (argc > 3) {
+        if (saveDictionaryTrie(d, argv[3]) < 0) {
+            perror(argv[3]);
+            return 1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        searched = loadDictionaryTrie(argv[3]);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (searched == NULL) {
+            fprintf(stderr, "%s: not a valid trie file\n", argv[3]);
+            return 1;
+        }
+        printf("trie file: %d nodes, mapped in %.2f ms\n",
+               searched->nodeCount, elapsedMs(&start, &end));
+    }
+    printf("%9s %12s %8s %12s %12s %8s %12s %12s %8s %12s\n", "board",
+           "all ms", "words", "visited", "auto ms", "letters", "visited",
+           "longest ms", "words", "visited");
+
+    for (int i = 0; i < (int)BOARD_SIZE_COUNT; i++) {
+        int dimension = boardSizes[i];
+        struct problem p;
+        memset(&p, 0, sizeof(p));
+        p.dimension = dimension;
+        p.board = generateBoard(dimension, &state);
+        p.words = d->words;
+        p.wordCount = d->wordCount;
+        p.partialString = randomBoardPrefix(p.board, dimension, 2, &state);
+
+        double times[3];
+        int counts[3];
+        long long visited[3] = {0, 0, 0};
+        for (int mode = 0; mode < 3; mode++) {
+            struct solution *s = NULL;
+#ifdef BOGGLE_STATS
+            boggleNodesVisited = 0;
+#endif
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (mode == 0) {
+                s = findAllValidWordsInDictionary(&p, searched);
+            } else if (mode == 1) {
+                s = autocompletePartialWordInDictionary(&p, searched);
+            } else {
+                s = findLongestValidWordInDictionary(&p, searched);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+#ifdef BOGGLE_STATS
+            visited[mode] = boggleNodesVisited;
+#endif
+            times[mode] = elapsedMs(&start, &end);
+            counts[mode] = mode == 1 ? s->foundLetterCount : s->foundWordCount;
+            freeSolution(s);
+        }
+
+        char label[32];
+        snprintf(label, sizeof(label), "%dx%d", dimension, dimension);
+        printf("%9s %12.3f %8d %12lld %12.3f %8d %12lld %12.3f %8d %12lld\n",
+               label, times[0], counts[0], visited[0], times[1], counts[1],
+               visited[1], times[2], counts[2], visited[2]);
+
+        for (int row = 0; row < dimension; row++) {
+            free(p.board[row]);
+        }
+        free(p.board);
+        free(p.partialString);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("peak RSS: %ld KB\n", usage.ru_maxrss);
+#ifndef BOGGLE_STATS
+    printf("(build with -DBOGGLE_STATS to count visited nodes)\n");
+#endif
+
+    if (searched != d) {
+        freeDictionary(searched);
+    }
+    freeDictionary(d);
+    return 0;
+}
+
+unsigned long long nextRandom(unsigned long long *state) {
+    unsigned long long x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+char **generateBoard(int dimension, unsigned long long *state) {
+    int total = 0;
+    for (int i = 0; i < 26; i++) {
+        total += letterFrequencies[i];
+    }
+
+    char **board = (char **)malloc(dimension * sizeof(char *));
+    assert(board);
+    for (int row = 0; row < dimension; row++) {
+        board[row] = (char *)malloc(dimension + 1);
+        assert(board[row]);
+        for (int col = 0; col < dimension; col++) {
+            int pick = nextRandom(state) % total;
+            int letter = 0;
+            while (pick >= letterFrequencies[letter]) {
+                pick -= letterFrequencies[letter];
+                letter++;
+            }
+            board[row][col] = boardLetters[letter];
+        }
+        board[row][dimension] = '\0';
+    }
+    return board;
+}
+
+char *randomBoardPrefix(char **board, int dimension, int length,
+                        unsigned long long *state) {
+    char *prefix = (char *)malloc(length + 1);
+    assert(prefix);
+    int row = nextRandom(state) % dimension;
+    int col = nextRandom(state) % dimension;
+    for (int i = 0; i < length; i++) {
+        prefix[i] = board[row][col] + 32;
+        /* Step to a random neighbour, staying on the board. */
+        int newRow, newCol;
+        do {
+            newRow = row + (int)(nextRandom(state) % 3) - 1;
+            newCol = col + (int)(nextRandom(state) % 3) - 1;
+        } while (newRow < 0 || newRow >= dimension || newCol < 0 ||
+                 newCol >= dimension || (newRow == row && newCol == col));
+        row = newRow;
+        col = newCol;
+    }
+    prefix[length] = '\0';
+    return prefix;
+}
+
+double elapsedMs(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e3 +
+           (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+void freeSolution(struct solution *s) {
+    free(s->words);
+    free(s->followLetters);
+    free(s);
+}
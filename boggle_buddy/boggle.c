@@ -6,44 +6,156 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "prefixTree.h"
+#include "dictionary.h"
 #include "boggle.h"
 
+#ifdef BOGGLE_STATS
+long long boggleNodesVisited = 0;
+#endif
+
+/* Modes of the iterative DFS engine. */
+#define ALL_WORDS_MODE (0)
+#define AUTOCOMPLETE_MODE (1)
+#define UNIQUE_LETTERS_MODE (2)
+#define COMPLETION_MODE (3)
+
+/* Arrays used to get row and column of 8 neighbors for a given cell */
+static const int rowNum[] = {-1, -1, -1, 0, 0, 1, 1, 1};
+static const int colNum[] = {-1, 0, 1, -1, 1, -1, 0, 1};
+
+/* A frame of the iterative DFS: the board cell, the next neighbour to try
+   and the trie node for the letters spelled so far. */
+struct dfsFrame {
+    int row;
+    int col;
+    int neighbour;
+    int node;
+};
+
+/* Everything a traversal needs, allocated once so that the search itself
+   rarely allocates. The stack only grows along trie edges, so it is bounded
+   by the longest dictionary word rather than the board size. */
+struct dfsEngine {
+    char **board;
+    int dimension;
+    int mode;
+    /* Trie nodes and marks of the dictionary searched. */
+    struct trieNode *nodes;
+    unsigned char *marks;
+    /* Visited flags for the cells, one byte each in row major order. */
+    char *visited;
+    struct dfsFrame *stack;
+    /* Prefix to follow in autocomplete mode. */
+    char *partialString;
+    int partialLength;
+    /* Letters used by the current path in unique letters mode. */
+    int usedLetters[256];
+    /* Trie node and cell pairs already expanded in unique letters mode. The
+       root is never expanded, so node 0 marks an empty slot. */
+    int *seenNodes;
+    int *seenCells;
+    int seenCapacity;
+    int seenCount;
+    /* Set as soon as a word is reachable in completion mode. */
+    int completed;
+};
+
+/* A board path in an autocomplete session, stored as its last cell and the
+   index of the path it extends (-1 for a path of a single cell). */
+struct sessionPath {
+    int row;
+    int col;
+    int parent;
+};
+
+/* Words collected for a solution, packed into one byte buffer that grows
+   geometrically, with the offset of each word into it. */
+struct wordArena {
+    char *bytes;
+    int usedBytes;
+    int byteCapacity;
+    int *offsets;
+    int wordCount;
+    int wordCapacity;
+};
+
+struct autocompleteSession {
+    char **board;
+    int dimension;
+    struct dictionary *dictionary;
+    /* Trie node for the current prefix, -1 once it has left the trie. */
+    int node;
+    int prefixLength;
+    /* Every path ever kept, the live ones being [liveStart, pathCount). */
+    struct sessionPath *paths;
+    int pathCount;
+    int pathCapacity;
+    int liveStart;
+    struct dfsEngine *engine;
+    /* Cached follow letters for the current prefix. */
+    struct solution *follow;
+};
+
 /* Checks that the index are within the dimensions and are not viisted. */
 int isSafe(char **board, int row, int col, int dimension, int **visited);
 
-/* Traverses each cell of the board for finding all valid words. */
-void findAllWordsInBoard(char **board, int dimension, struct prefixTree *tree);
+/* Creates a DFS engine for the board and dictionary in the given mode. */
+struct dfsEngine *newDFSEngine(char **board, int dimension,
+                               struct dictionary *d, int mode);
 
-/* Implements DFS for finding all valid words. */
-void findAllWordsDFS(char **board, int row, int col, int dimension, int **visited,
-              struct prefixTree *tree);
+/* Frees a DFS engine. */
+void freeDFSEngine(struct dfsEngine *engine);
 
-/* Traverses each cell of the board for autocomplete partial words. */
-void autocompleteTraversal(char **board, int dimension, struct prefixTree *tree,
-                        char *partialString);
+/* Implements DFS with an explicit stack from a cell matching the node. */
+void iterativeDFS(struct dfsEngine *engine, int row, int col, int node);
+
+/* Applies the mode specific marking when the DFS reaches a trie node. */
+void visitNode(struct dfsEngine *engine, int node, int depth);
+
+/* Records a trie node and cell pair, returning 0 if it was already seen. */
+int markSeen(struct dfsEngine *engine, int node, int cell);
+
+/* Returns the child of a trie node for a letter, or -1 if there is none. */
+int trieChild(struct trieNode *nodes, int node, int letter);
 
-/* Implements DFS for autocomplete partial words. */
-void autocompleteDFS(char **board, int row, int col, int dimension, int **visited,
-              struct prefixTree *tree, char *partialString,
-              int indexPartialString);
+/* Traverses each cell of the board for finding all valid words. */
+void findAllWordsInBoard(char **board, int dimension, struct dictionary *d);
+
+/* Traverses each cell of the board for autocomplete partial words. */
+void autocompleteTraversal(char **board, int dimension, struct dictionary *d,
+                           char *partialString);
 
 /* Traverses each cell of the board for longest valid word. */
-void findLongestWordTraversal(char **board, int dimension, struct prefixTree *tree);
+void findLongestWordTraversal(char **board, int dimension,
+                              struct dictionary *d);
 
 /* Finds all next possible characters from a given prefix tree node. */
-void getNextPossibleLetters(struct prefixTree *node, struct solution *s);
+void getNextPossibleLetters(struct dictionary *d, int node,
+                            struct solution *s);
 
 /* Finds the prefix tree node corresponding to the prefix last character. */
-struct prefixTree *findNode(struct prefixTree *root, char *prefix);
+int findNode(struct dictionary *d, char *prefix);
+
+/* Checks whether the cell is already used by the given session path. */
+int isOnPath(struct autocompleteSession *session, int path, int row, int col);
+
+/* Appends a path to the session, growing the path array when needed. */
+void addSessionPath(struct autocompleteSession *session, int row, int col,
+                    int parent);
+
+/* Traverses the prefix trie to find all marked words, spelling each into
+   the word buffer, which holds the letters down to the node. */
+void collectMarkedWords(struct dictionary *d, int node, char *word,
+                        int length, struct wordArena *arena);
 
-/* Implements DFS for longest valid word. */
-void findLongestWordDFS(char **board, int dimension, int **visited,
-              struct prefixTree *tree, int *builtWord, int **current);
+/* Returns a new empty word arena. */
+struct wordArena *newWordArena();
 
-/* Traverses the prefix trie to find all marked words. */
-void collectMarkedWords(struct prefixTree *node, char *prefix, int level,
-               struct solution *s);
+/* Appends a word of the given length to the arena. */
+void addWordToArena(struct wordArena *arena, char *word, int length);
+
+/* Moves the arena words into the solution and frees the arena. */
+void arenaToSolution(struct wordArena *arena, struct solution *s);
 
 /* Dynamically allocate memory for a 2D matrix. */
 int **createMatrix(int rows, int cols);
@@ -54,392 +166,742 @@ void resetMatrix(int **matrix, int rows, int cols);
 /* Display a 2D matrix. */
 void displayMatrix(int **matrix, int rows, int cols);
 
-/* Mark next letters that are next to a 1 in the integer matrix. */
-int **markAdjacentOnes(char **board, int dimension, int **visited,
-                       int **current, char lowercaseLetter);
-
 struct solution *findAllValidWords(struct problem *p) {
+    struct dictionary *d = newDictionary(p->words, p->wordCount);
+    struct solution *s = findAllValidWordsInDictionary(p, d);
+    freeDictionary(d);
+    return s;
+}
+
+/*
+    Finds all valid words using an already built dictionary, such as one
+    from loadDictionary or loadDictionaryTrie. The marks are cleared for the
+    next search.
+*/
+struct solution *findAllValidWordsInDictionary(struct problem *p,
+                                               struct dictionary *d) {
     struct solution *s = newSolution(p);
-    struct prefixTree *tree = newPrefixTree();
-    // Add words to the prefix trie
-    for (int i = 0; i < p->wordCount; i++) {
-        tree = addWordToTree(tree, p->words[i]);
+    findAllWordsInBoard(p->board, p->dimension, d);
+    struct wordArena *arena = newWordArena();
+    char *word = (char *)malloc(d->longestWord + 1);
+    assert(word);
+    collectMarkedWords(d, 0, word, 0, arena);
+    free(word);
+    arenaToSolution(arena, s);
+    return s;
+}
+
+/*
+    Creates a DFS engine for the board and dictionary in the given mode.
+*/
+struct dfsEngine *newDFSEngine(char **board, int dimension,
+                               struct dictionary *d, int mode) {
+    struct dfsEngine *engine =
+        (struct dfsEngine *)malloc(sizeof(struct dfsEngine));
+    assert(engine);
+    engine->board = board;
+    engine->dimension = dimension;
+    engine->mode = mode;
+    engine->nodes = d->nodes;
+    engine->marks = d->marks;
+    // Initially all cells are unvisited
+    engine->visited = (char *)calloc((size_t)dimension * dimension, 1);
+    assert(engine->visited);
+    // Each frame spells one more letter, so no path is deeper than the
+    // longest word
+    engine->stack = (struct dfsFrame *)malloc((d->longestWord + 1) *
+                                              sizeof(struct dfsFrame));
+    assert(engine->stack);
+    engine->partialString = NULL;
+    engine->partialLength = 0;
+    for (int i = 0; i < 256; i++) {
+        engine->usedLetters[i] = 0;
     }
+    engine->seenNodes = NULL;
+    engine->seenCells = NULL;
+    engine->seenCapacity = 0;
+    engine->seenCount = 0;
+    engine->completed = 0;
+    return engine;
+}
 
-    findAllWordsInBoard(p->board, p->dimension, tree);
-    char prefix[100];
-    collectMarkedWords(tree, prefix, 0, s);
-    return s;
+/*
+    Frees a DFS engine.
+*/
+void freeDFSEngine(struct dfsEngine *engine) {
+    free(engine->visited);
+    free(engine->stack);
+    free(engine->seenNodes);
+    free(engine->seenCells);
+    free(engine);
 }
 
 /*
-    Implements DFS for finding all valid words.
+    Implements DFS with an explicit stack from a cell matching the node. Each
+    frame remembers which neighbour to try next, so backtracking resumes the
+    parent frame where it left off. The visited cells and used letters are
+    cleared on the way back, leaving the engine ready for the next cell.
 */
-void findAllWordsDFS(char **board, int row, int col, int dimension, int **visited,
-              struct prefixTree *tree) {
+void iterativeDFS(struct dfsEngine *engine, int row, int col, int node) {
+    char **board = engine->board;
+    int dimension = engine->dimension;
+    char *visited = engine->visited;
+    struct dfsFrame *stack = engine->stack;
+    struct trieNode *nodes = engine->nodes;
+    int mode = engine->mode;
+    int top = 0;
+
+    if (mode == UNIQUE_LETTERS_MODE) {
+        if (!markSeen(engine, node, row * dimension + col)) {
+            return;
+        }
+        engine->usedLetters[board[row][col] + 32] = 1;
+    }
+    stack[0].row = row;
+    stack[0].col = col;
+    stack[0].neighbour = 0;
+    stack[0].node = node;
     // Mark this cell as visited
-    visited[row][col] = 1;
-    // Check each time if the word is terminated, if it is, mark it
-    if (tree->children[0] && tree->children[0]->found == UNMARKED) {
-        tree->children[0]->found = MARKED;
-    }
-
-    // Arrays used to get row and column of 8 neighbors for a given cell
-    int rowNum[] = {-1, -1, -1, 0, 0, 1, 1, 1};
-    int colNum[] = {-1, 0, 1, -1, 1, -1, 0, 1};
-
-    // Recur for all connected neighbors
-    for (int k = 0; k < 8; k++) {
-        int newRow = row + rowNum[k];
-        int newCol = col + colNum[k];
-        // Check whether it is in the boundaries and it is not visited
-        if (isSafe(board, newRow, newCol, dimension, visited)) {
-            int lowercaseLetter = board[newRow][newCol] + 32;
+    visited[row * dimension + col] = 1;
+    visitNode(engine, node, 0);
+#ifdef BOGGLE_STATS
+    boggleNodesVisited++;
+#endif
+
+    while (top >= 0 && !engine->completed) {
+        struct dfsFrame *frame = &stack[top];
+        int child = -1;
+        int newRow = 0, newCol = 0, lowercaseLetter = 0;
+        int k = frame->neighbour;
+
+        // Find the next neighbour that continues a word
+        for (; k < 8; k++) {
+            newRow = frame->row + rowNum[k];
+            newCol = frame->col + colNum[k];
+            // Check whether it is in the boundaries and it is not visited
+            if (newRow < 0 || newRow >= dimension || newCol < 0 ||
+                newCol >= dimension || !board[newRow][newCol] ||
+                visited[newRow * dimension + newCol]) {
+                continue;
+            }
+            lowercaseLetter = board[newRow][newCol] + 32;
             // Check if that letter is a subsequent letter in the prefix trie
-            if (tree->children[lowercaseLetter]) {
-                autocompleteTraversal(board, newRow, newCol, dimension, visited,
-                         tree->children[lowercaseLetter]);
-                // Mark the backtracked cell as unvisited for future visits
-                visited[newRow][newCol] = 0;
+            child = trieChild(nodes, frame->node, lowercaseLetter);
+            if (child < 0) {
+                continue;
+            }
+            // Follow the partial string until it has been spelled out
+            if (mode == AUTOCOMPLETE_MODE && top + 1 < engine->partialLength &&
+                lowercaseLetter != engine->partialString[top + 1]) {
+                child = -1;
+                continue;
+            }
+            // The trie node fixes the letters used so far, so a node and cell
+            // pair always leads to the same words and is expanded only once
+            if (mode == UNIQUE_LETTERS_MODE &&
+                (engine->usedLetters[lowercaseLetter] ||
+                 !markSeen(engine, child, newRow * dimension + newCol))) {
+                child = -1;
+                continue;
+            }
+            break;
+        }
+        // Resume after this neighbour when the DFS comes back to the frame
+        frame->neighbour = k + 1;
+
+        if (child < 0) {
+            // Mark the backtracked cell as unvisited for future visits
+            visited[frame->row * dimension + frame->col] = 0;
+            engine->usedLetters[board[frame->row][frame->col] + 32] = 0;
+            // Mark the parent if a word was found below this node
+            if (mode == AUTOCOMPLETE_MODE && top > 0 &&
+                (engine->marks[frame->node] & NODE_MARKED)) {
+                engine->marks[stack[top - 1].node] |= NODE_MARKED;
             }
+            top--;
+            continue;
+        }
+
+        top++;
+        stack[top].row = newRow;
+        stack[top].col = newCol;
+        stack[top].neighbour = 0;
+        stack[top].node = child;
+        visited[newRow * dimension + newCol] = 1;
+#ifdef BOGGLE_STATS
+        boggleNodesVisited++;
+#endif
+        if (mode == UNIQUE_LETTERS_MODE) {
+            engine->usedLetters[lowercaseLetter] = 1;
+        }
+        if (nodes[child].terminal) {
+            visitNode(engine, child, top);
         }
     }
+
+    // Completion mode may stop early, leaving frames on the stack
+    for (; top >= 0; top--) {
+        visited[stack[top].row * dimension + stack[top].col] = 0;
+        engine->usedLetters[board[stack[top].row][stack[top].col] + 32] = 0;
+    }
+}
+
+/*
+    Applies the mode specific marking when the DFS reaches a trie node at the
+    given depth (0 for the first letter).
+*/
+void visitNode(struct dfsEngine *engine, int node, int depth) {
+    if (!engine->nodes[node].terminal) {
+        return;
+    }
+    switch (engine->mode) {
+        case AUTOCOMPLETE_MODE:
+            // Only words extending the whole partial string count
+            if (depth + 1 >= engine->partialLength) {
+                engine->marks[node] |= WORD_MARKED | NODE_MARKED;
+            }
+            break;
+        case COMPLETION_MODE:
+            engine->completed = 1;
+            break;
+        default:
+            // Check each time if the word is terminated, if it is, mark it
+            engine->marks[node] |= WORD_MARKED;
+            break;
+    }
+}
+
+/*
+    Records a trie node and cell pair in an open addressing hash set, returning
+    0 if it was already seen.
+*/
+int markSeen(struct dfsEngine *engine, int node, int cell) {
+    // Keep the table at most half full
+    if (2 * (engine->seenCount + 1) > engine->seenCapacity) {
+        int oldCapacity = engine->seenCapacity;
+        int *oldNodes = engine->seenNodes;
+        int *oldCells = engine->seenCells;
+        engine->seenCapacity = oldCapacity ? 2 * oldCapacity : 1024;
+        engine->seenNodes = (int *)calloc(engine->seenCapacity, sizeof(int));
+        engine->seenCells = (int *)malloc(engine->seenCapacity * sizeof(int));
+        assert(engine->seenNodes && engine->seenCells);
+        engine->seenCount = 0;
+        for (int i = 0; i < oldCapacity; i++) {
+            if (oldNodes[i]) {
+                markSeen(engine, oldNodes[i], oldCells[i]);
+            }
+        }
+        free(oldNodes);
+        free(oldCells);
+    }
+
+    unsigned long long hash =
+        ((unsigned long long)(unsigned)node * 31 + (unsigned)cell) *
+        0x9E3779B97F4A7C15ULL;
+    int mask = engine->seenCapacity - 1;
+    int slot = (int)(hash >> 32) & mask;
+    while (engine->seenNodes[slot]) {
+        if (engine->seenNodes[slot] == node && engine->seenCells[slot] == cell) {
+            return 0;
+        }
+        slot = (slot + 1) & mask;
+    }
+    engine->seenNodes[slot] = node;
+    engine->seenCells[slot] = cell;
+    engine->seenCount++;
+    return 1;
+}
+
+/*
+    Returns the child of a trie node for a letter, or -1 if there is none.
+    The children are sorted by letter, so the scan stops at the first child
+    past the letter.
+*/
+int trieChild(struct trieNode *nodes, int node, int letter) {
+    int child = nodes[node].firstChild;
+    int end = child + nodes[node].childCount;
+    for (; child < end && nodes[child].letter <= letter; child++) {
+        if (nodes[child].letter == letter) {
+            return child;
+        }
+    }
+    return -1;
 }
 
 /*
     Traverses each cell of the board for finding all valid words.
 */
-void findAllWordsInBoard(char **board, int dimension, struct prefixTree *tree) {
-    // Matrix to mark visited cells. Initially all cells are unvisited
-    int **visited = createMatrix(dimension, dimension);
+void findAllWordsInBoard(char **board, int dimension, struct dictionary *d) {
+    struct dfsEngine *engine =
+        newDFSEngine(board, dimension, d, ALL_WORDS_MODE);
 
     // Traverse through all cells of given matrix
     for (int i = 0; i < dimension; i++) {
         for (int j = 0; j < dimension; j++) {
-            // Reset the visited cells at each traversal
-            resetMatrix(visited, dimension, dimension);
-
-            int lowercaseLetter = board[i][j] + 32;
             // Check if that letter is a subsequent letter in the prefix trie
-            if (tree->children[lowercaseLetter]) {
+            int child = board[i][j] ? trieChild(d->nodes, 0, board[i][j] + 32)
+                                    : -1;
+            if (child >= 0) {
                 // Visit all cells in this connected component
-                autocompleteTraversal(board, i, j, dimension, visited,
-                         tree->children[lowercaseLetter]);
+                iterativeDFS(engine, i, j, child);
             }
         }
     }
+    freeDFSEngine(engine);
 }
 
 struct solution *autocompletePartialWord(struct problem *p) {
-    struct solution *s = newSolution(p);
-    struct prefixTree *tree = newPrefixTree();
-    // Add words to the prefix trie
-    for (int i = 0; i < p->wordCount; i++) {
-        tree = addWordToTree(tree, p->words[i]);
-    }
-
-    autocompleteTraversal(p->board, p->dimension, tree, p->partialString);
-    // Find the node corresponding to the last character of the prefix
-    struct prefixTree *prefixNode = findNode(tree, p->partialString);
-    if (prefixNode == NULL) {
-        printf("Prefix not found in the Trie.\n");
-    } else {
-        // Find the next possible characters
-        getNextPossibleLetters(prefixNode, s);
-    }
+    struct dictionary *d = newDictionary(p->words, p->wordCount);
+    struct solution *s = autocompletePartialWordInDictionary(p, d);
+    freeDictionary(d);
     return s;
 }
 
 /*
-    Implements DFS for autocomplete partial words.
+    Autocompletes the partial word using an already built dictionary. The
+    marks are cleared for the next search.
 */
-void autocompleteDFS(char **board, int row, int col, int dimension, int **visited,
-              struct prefixTree *tree, char *partialString,
-              int indexPartialString) {
-    // Base case: we traverse until we reach the end of the partial string
-    if (indexPartialString == strlen(partialString)) {
-        // Mark this cell as visited
-        visited[row][col] = 1;
-        // Check each time if the word is terminated, if it is, mark it
-        if (tree->children[0] && tree->children[0]->found == UNMARKED) {
-            tree->children[0]->found = MARKED;
-            tree->found = MARKED;
-        }
+struct solution *autocompletePartialWordInDictionary(struct problem *p,
+                                                     struct dictionary *d) {
+    struct solution *s = newSolution(p);
+    autocompleteTraversal(p->board, p->dimension, d, p->partialString);
+    // Find the node corresponding to the last character of the prefix
+    int prefixNode = findNode(d, p->partialString);
+    if (prefixNode < 0) {
+        printf("Prefix not found in the Trie.\n");
     } else {
-        // Else, we continue to traverse the partial string
-        indexPartialString++;
-    }
-
-    // Mark this cell as visited
-    visited[row][col] = 1;
-
-    // Arrays used to get row and column of 8 neighbors for a given cell
-    int rowNum[] = {-1, -1, -1, 0, 0, 1, 1, 1};
-    int colNum[] = {-1, 0, 1, -1, 1, -1, 0, 1};
-
-    // Recur for all connected neighbors
-    for (int k = 0; k < 8; k++) {
-        int newRow = row + rowNum[k];
-        int newCol = col + colNum[k];
-        // Check whether it is in the boundaries and it is not visited
-        if (isSafe(board, newRow, newCol, dimension, visited)) {
-            int lowercaseLetter = board[newRow][newCol] + 32;
-            // Check if that letter is a subsequent letter in the prefix trie
-            if (tree->children[lowercaseLetter]) {
-                if (indexPartialString == strlen(partialString) ||
-                    lowercaseLetter == partialString[indexPartialString - 1]) {
-                    autocompleteDFS(board, newRow, newCol, dimension, visited,
-                             tree->children[lowercaseLetter], partialString,
-                             indexPartialString);
-
-                    // Mark the backtracked cell as unvisited for future visits
-                    visited[newRow][newCol] = 0;
-                    // Mark word if terminated
-                    if (tree->children[lowercaseLetter]->found == MARKED) {
-                        tree->found = MARKED;
-                    }
-                }
-            }
-        }
+        // Find the next possible characters
+        getNextPossibleLetters(d, prefixNode, s);
     }
+    memset(d->marks, 0, d->nodeCount);
+    return s;
 }
 
 /*
     Traverses each cell of the board for autocomplete partial words.
 */
-void autocompleteTraversal(char **board, int dimension, struct prefixTree *tree,
-                        char *partialString) {
-    // Matrix to mark visited cells. Initially all cells are unvisited
-    int **visited = createMatrix(dimension, dimension);
+void autocompleteTraversal(char **board, int dimension, struct dictionary *d,
+                           char *partialString) {
+    struct dfsEngine *engine =
+        newDFSEngine(board, dimension, d, AUTOCOMPLETE_MODE);
+    engine->partialString = partialString;
+    engine->partialLength = strlen(partialString);
 
     // Traverse through the all cells of given matrix
     for (int i = 0; i < dimension; i++) {
         for (int j = 0; j < dimension; j++) {
-            // Reset the visited cells
-            resetMatrix(visited, dimension, dimension);
-
             int lowercaseLetter = board[i][j] + 32;
+            if (!board[i][j] || lowercaseLetter != partialString[0]) {
+                continue;
+            }
             // Check if that letter is a subsequent letter in the prefix trie
-            if (board[i][j] && !visited[i][j] &&
-                tree->children[lowercaseLetter] &&
-                lowercaseLetter == partialString[0]) {
+            int child = trieChild(d->nodes, 0, lowercaseLetter);
+            if (child >= 0) {
                 // Visit all cells in this connected component
-                autocompleteDFS(board, i, j, dimension, visited,
-                         tree->children[lowercaseLetter], partialString, 1);
+                iterativeDFS(engine, i, j, child);
             }
         }
     }
+    freeDFSEngine(engine);
 }
 
 /*
     Finds the prefix tree node corresponding to the prefix last character.
 */
-struct prefixTree *findNode(struct prefixTree *root, char *prefix) {
-    struct prefixTree *current = root;
+int findNode(struct dictionary *d, char *prefix) {
+    int current = 0;
 
     // Loop until we reach the end of the prefix
     while (*prefix) {
-        int index = *prefix;
-        if (current->children[index] == NULL) {
-            return NULL;  // Prefix not found
+        current = trieChild(d->nodes, current, (unsigned char)*prefix);
+        if (current < 0) {
+            return -1;  // Prefix not found
         }
-        current = current->children[index];
         prefix++;  // Next character on prefix
     }
     return current;
 }
 
 /*
-    Finds all next possible characters from a given prefix tree node.
+    Finds all next possible characters from a given prefix tree node, in
+    letter order after a 0 for the prefix itself being a word. The letters
+    are gathered first so the solution gets a single allocation.
 */
-void getNextPossibleLetters(struct prefixTree *node, struct solution *s) {
-    for (int i = 0; i < 256; i++) {
-        // Check if there's a children first and if that children is marked
-        if (node->children[i] && node->children[i]->found == MARKED) {
-            s->followLetters = realloc(
-                s->followLetters, (s->foundLetterCount + 1) * sizeof(char));
-            s->followLetters[s->foundLetterCount] = (char)i;
-            s->foundLetterCount++;
+void getNextPossibleLetters(struct dictionary *d, int node,
+                            struct solution *s) {
+    char letters[257];
+    int letterCount = 0;
+    if (d->marks[node] & WORD_MARKED) {
+        letters[letterCount++] = 0;
+    }
+    struct trieNode *trie = &d->nodes[node];
+    for (int i = 0; i < trie->childCount; i++) {
+        // Check if that child has a word below it
+        int child = trie->firstChild + i;
+        if (d->marks[child] & NODE_MARKED) {
+            letters[letterCount++] = (char)d->nodes[child].letter;
         }
     }
+    if (letterCount == 0) {
+        return;
+    }
+    s->followLetters = (char *)malloc(letterCount * sizeof(char));
+    assert(s->followLetters);
+    memcpy(s->followLetters, letters, letterCount);
+    s->foundLetterCount = letterCount;
 }
 
-struct solution *findLongestValidWord(struct problem *p) {
-    struct solution *s = newSolution(p);
-    struct prefixTree *tree = newPrefixTree();
-    for (int i = 0; i < p->wordCount; i++) {
-        tree = addWordToTree(tree, p->words[i]);
+/*
+    Starts an autocomplete session with an empty prefix. The session keeps
+    its own dictionary so it can outlive the problem's word list.
+*/
+struct autocompleteSession *newAutocompleteSession(struct problem *p) {
+    struct autocompleteSession *session =
+        (struct autocompleteSession *)malloc(sizeof(struct autocompleteSession));
+    assert(session);
+    session->board = p->board;
+    session->dimension = p->dimension;
+    session->dictionary = newDictionary(p->words, p->wordCount);
+    session->node = 0;
+    session->prefixLength = 0;
+    session->paths = NULL;
+    session->pathCount = 0;
+    session->pathCapacity = 0;
+    session->liveStart = 0;
+    session->engine = newDFSEngine(p->board, p->dimension, session->dictionary,
+                                   COMPLETION_MODE);
+    session->follow = NULL;
+    return session;
+}
+
+/*
+    Extends the session prefix by one letter. Only the live paths are
+    expanded, so typing a word costs the same as one traversal for the whole
+    word. Returns the number of paths on the board spelling the new prefix.
+*/
+int extendAutocompleteSession(struct autocompleteSession *session,
+                              char letter) {
+    int index = (unsigned char)letter;
+
+    // Any cached letters belong to the previous prefix
+    if (session->follow) {
+        free(session->follow->followLetters);
+        free(session->follow);
+        session->follow = NULL;
     }
 
-    findLongestWordTraversal(p->board, p->dimension, tree);
-    char prefix[100];
-    collectMarkedWords(tree, prefix, 0, s);
-    return s;
+    // A prefix that left the trie can never come back into it
+    if (session->node >= 0) {
+        session->node =
+            trieChild(session->dictionary->nodes, session->node, index);
+    }
+    if (session->node < 0) {
+        session->liveStart = session->pathCount;
+        session->prefixLength++;
+        return 0;
+    }
+
+    int oldStart = session->liveStart;
+    int oldEnd = session->pathCount;
+    session->liveStart = oldEnd;
+
+    if (session->prefixLength == 0) {
+        // The first letter may start on any matching cell
+        for (int i = 0; i < session->dimension; i++) {
+            for (int j = 0; j < session->dimension; j++) {
+                if (session->board[i][j] &&
+                    session->board[i][j] + 32 == index) {
+                    addSessionPath(session, i, j, -1);
+                }
+            }
+        }
+    } else {
+        // Otherwise only step from the end of each live path
+        for (int path = oldStart; path < oldEnd; path++) {
+            for (int k = 0; k < 8; k++) {
+                int newRow = session->paths[path].row + rowNum[k];
+                int newCol = session->paths[path].col + colNum[k];
+                if (newRow < 0 || newRow >= session->dimension ||
+                    newCol < 0 || newCol >= session->dimension ||
+                    !session->board[newRow][newCol] ||
+                    session->board[newRow][newCol] + 32 != index) {
+                    continue;
+                }
+                if (!isOnPath(session, path, newRow, newCol)) {
+                    addSessionPath(session, newRow, newCol, path);
+                }
+            }
+        }
+    }
+    session->prefixLength++;
+    return session->pathCount - session->liveStart;
 }
 
 /*
-    Traverses the prefix trie to find all marked words.
+    Finds the next possible letters for the session prefix, in the same order
+    as autocompletePartialWord. The search only starts from the live paths and
+    each letter is confirmed at most once, so the cost follows the number of
+    live paths rather than the board size. The solution is owned by the
+    session and stays valid until the prefix changes.
 */
-void collectMarkedWords(struct prefixTree *node, char *prefix, int level,
-               struct solution *s) {
-    // If a node in the prefix trie is marked found, add it into s->words
-    if (node->found) {
-        s->words = realloc(s->words, (s->foundWordCount + 1) * sizeof(char *));
-        s->words[s->foundWordCount] = (char *)malloc(strlen(node->data) + 1);
-        strcpy(s->words[s->foundWordCount], node->data);
-        s->foundWordCount++;
+struct solution *sessionFollowLetters(struct autocompleteSession *session) {
+    if (session->follow) {
+        return session->follow;
+    }
+    struct solution *s =
+        (struct solution *)malloc(sizeof(struct solution));
+    assert(s);
+    s->followLetters = NULL;
+    s->foundLetterCount = 0;
+    s->words = NULL;
+    s->foundWordCount = 0;
+    session->follow = s;
+
+    int liveCount = session->pathCount - session->liveStart;
+    if (session->node < 0 || session->prefixLength == 0 || liveCount == 0) {
+        return s;
+    }
+
+    struct dfsEngine *engine = session->engine;
+    struct trieNode *nodes = session->dictionary->nodes;
+    int confirmed[256] = {0};
+    // The prefix is itself a word on the board
+    if (nodes[session->node].terminal) {
+        confirmed[0] = 1;
+    }
+
+    for (int path = session->liveStart; path < session->pathCount; path++) {
+        // Mark the cells of this path as visited
+        for (int p = path; p != -1; p = session->paths[p].parent) {
+            engine->visited[session->paths[p].row * session->dimension +
+                            session->paths[p].col] = 1;
+        }
+        for (int k = 0; k < 8; k++) {
+            int newRow = session->paths[path].row + rowNum[k];
+            int newCol = session->paths[path].col + colNum[k];
+            if (newRow >= 0 && newRow < session->dimension && newCol >= 0 &&
+                newCol < session->dimension && session->board[newRow][newCol] &&
+                !engine->visited[newRow * session->dimension + newCol]) {
+                int lowercaseLetter = session->board[newRow][newCol] + 32;
+                int child = confirmed[lowercaseLetter]
+                                ? -1
+                                : trieChild(nodes, session->node,
+                                            lowercaseLetter);
+                if (child >= 0) {
+                    // Stop at the first word reachable through this letter
+                    engine->completed = 0;
+                    iterativeDFS(engine, newRow, newCol, child);
+                    confirmed[lowercaseLetter] = engine->completed;
+                }
+            }
+        }
+        // Unmark the path for the next one
+        for (int p = path; p != -1; p = session->paths[p].parent) {
+            engine->visited[session->paths[p].row * session->dimension +
+                            session->paths[p].col] = 0;
+        }
     }
 
-    // Use DFS to find all the words recursively
     for (int i = 0; i < 256; i++) {
-        if (node->children[i]) {
-            prefix[level] = 'a' + i;
-            collectMarkedWords(node->children[i], prefix, level + 1, s);
+        if (confirmed[i]) {
+            s->foundLetterCount++;
         }
     }
+    s->followLetters = (char *)malloc(s->foundLetterCount * sizeof(char) + 1);
+    assert(s->followLetters);
+    s->foundLetterCount = 0;
+    for (int i = 0; i < 256; i++) {
+        if (confirmed[i]) {
+            s->followLetters[s->foundLetterCount++] = (char)i;
+        }
+    }
+    return s;
 }
 
 /*
-    Checks that the index are within the dimensions and are not viisted.
+    Frees the session along with its dictionary and cached letters.
 */
-int isSafe(char **board, int row, int col, int dimension, int **visited) {
-    return (row >= 0) && (row < dimension) && (col >= 0) && (col < dimension) &&
-           (board[row][col] && !visited[row][col]);
+void freeAutocompleteSession(struct autocompleteSession *session) {
+    if (session->follow) {
+        free(session->follow->followLetters);
+        free(session->follow);
+    }
+    freeDFSEngine(session->engine);
+    free(session->paths);
+    freeDictionary(session->dictionary);
+    free(session);
+}
+
+/*
+    Checks whether the cell is already used by the given session path.
+*/
+int isOnPath(struct autocompleteSession *session, int path, int row, int col) {
+    for (int p = path; p != -1; p = session->paths[p].parent) {
+        if (session->paths[p].row == row && session->paths[p].col == col) {
+            return 1;
+        }
+    }
+    return 0;
 }
 
 /*
-    Implements DFS for finding logest valid word.
+    Appends a path to the session, growing the path array when needed.
 */
-void findLongestWordDFS(char **board, int dimension, int **visited,
-              struct prefixTree *tree, int *builtWord, int **current) {
-    // Check each time if the word is terminated, if it is, mark it
-    if (tree->children[0] && tree->children[0]->found == UNMARKED) {
-        tree->children[0]->found = MARKED;
+void addSessionPath(struct autocompleteSession *session, int row, int col,
+                    int parent) {
+    if (session->pathCount == session->pathCapacity) {
+        session->pathCapacity =
+            session->pathCapacity ? 2 * session->pathCapacity : 64;
+        session->paths = (struct sessionPath *)realloc(
+            session->paths, session->pathCapacity * sizeof(struct sessionPath));
+        assert(session->paths);
     }
+    session->paths[session->pathCount].row = row;
+    session->paths[session->pathCount].col = col;
+    session->paths[session->pathCount].parent = parent;
+    session->pathCount++;
+}
 
-    // Arrays used to get row and column of 8 neighbors for a given cell
-    int rowNum[] = {-1, -1, -1, 0, 0, 1, 1, 1};
-    int colNum[] = {-1, 0, 1, -1, 1, -1, 0, 1};
+struct solution *findLongestValidWord(struct problem *p) {
+    struct dictionary *d = newDictionary(p->words, p->wordCount);
+    struct solution *s = findLongestValidWordInDictionary(p, d);
+    freeDictionary(d);
+    return s;
+}
 
-    // Create another matrix to store the subsequent letters
-    int **next = createMatrix(dimension, dimension);
-    resetMatrix(next, dimension, dimension);
+/*
+    Finds the valid words without repeated letters using an already built
+    dictionary. The marks are cleared for the next search.
+*/
+struct solution *findLongestValidWordInDictionary(struct problem *p,
+                                                  struct dictionary *d) {
+    struct solution *s = newSolution(p);
+    findLongestWordTraversal(p->board, p->dimension, d);
+    struct wordArena *arena = newWordArena();
+    char *word = (char *)malloc(d->longestWord + 1);
+    assert(word);
+    collectMarkedWords(d, 0, word, 0, arena);
+    free(word);
+    arenaToSolution(arena, s);
+    return s;
+}
 
-    // Create another matrix to store considered letters to avoid repetition
-    int consideredLetters[256] = {0};
+/*
+    Traverses the prefix trie to find all marked words.
+*/
+void collectMarkedWords(struct dictionary *d, int node, char *word,
+                        int length, struct wordArena *arena) {
+    // If a word in the prefix trie is marked found, add it into the arena
+    // and unmark it so the trie can be searched again
+    if (d->marks[node] & WORD_MARKED) {
+        addWordToArena(arena, word, length);
+        d->marks[node] = 0;
+    }
 
-    // Traverse current matrix and find cells equal to 1
-    for (int i = 0; i < dimension; i++) {
-        for (int j = 0; j < dimension; j++) {
-            if (current[i][j] == 1) {
-                // Mark this cell as visited
-                visited[i][j] = 1;
-
-                // Recur for all connected neighbors
-                for (int k = 0; k < 8; k++) {
-                    int newRow = i + rowNum[k];
-                    int newCol = j + colNum[k];
-                    // Check whether it is in the boundaries and not visited
-                    if (isSafe(board, newRow, newCol, dimension, visited)) {
-                        int lowercaseLetter = board[newRow][newCol] + 32;
-                        // Check if that letter is a subsequent letter in the
-                        // prefix trie
-                        if (tree->children[lowercaseLetter] &&
-                            !builtWord[lowercaseLetter] &&
-                            !consideredLetters[lowercaseLetter]) {
-                            // Mark the letter to ensure uniqueness
-                            builtWord[lowercaseLetter] = 1;
-                            // Mark the letter to ensure we don't consider
-                            // it again in the future
-                            consideredLetters[lowercaseLetter] = 1;
-                            // Find all same letters that on the board
-                            next = markAdjacentOnes(board, dimension, visited,
-                                                    current, lowercaseLetter);
-                            findLongestWordDFS(board, dimension, visited,
-                                     tree->children[lowercaseLetter], builtWord,
-                                     next);
-                            // Mark the backtracked cell as not repeated for
-                            // future visits
-                            builtWord[lowercaseLetter] = 0;
-                        }
-                    }
-                }
-                // Mark the backtracked cell as unvisited for future visits
-                visited[i][j] = 0;
-            }
-        }
+    // Use DFS to find all the words recursively, in letter order
+    struct trieNode *trie = &d->nodes[node];
+    for (int i = 0; i < trie->childCount; i++) {
+        int child = trie->firstChild + i;
+        word[length] = (char)d->nodes[child].letter;
+        collectMarkedWords(d, child, word, length + 1, arena);
     }
 }
 
-// Mark next letters that are next to a 1 in the integer matrix
-int **markAdjacentOnes(char **board, int dimension, int **visited,
-                       int **current, char lowercaseLetter) {
-    // Arrays used to get row and column of 8 neighbors for a given cell
-    int rowNum[] = {-1, -1, -1, 0, 0, 1, 1, 1};
-    int colNum[] = {-1, 0, 1, -1, 1, -1, 0, 1};
+/*
+    Returns a new empty word arena.
+*/
+struct wordArena *newWordArena() {
+    struct wordArena *arena =
+        (struct wordArena *)malloc(sizeof(struct wordArena));
+    assert(arena);
+    arena->bytes = NULL;
+    arena->usedBytes = 0;
+    arena->byteCapacity = 0;
+    arena->offsets = NULL;
+    arena->wordCount = 0;
+    arena->wordCapacity = 0;
+    return arena;
+}
 
-    // Create another matrix to store the subsequent letters
-    int **next = createMatrix(dimension, dimension);
-    resetMatrix(next, dimension, dimension);
+/*
+    Appends a word of the given length to the arena, doubling the buffers
+    when they are full so that growth is amortised over all words.
+*/
+void addWordToArena(struct wordArena *arena, char *word, int length) {
+    if (arena->usedBytes + length + 1 > arena->byteCapacity) {
+        int capacity = arena->byteCapacity ? arena->byteCapacity : 1024;
+        while (arena->usedBytes + length + 1 > capacity) {
+            capacity *= 2;
+        }
+        arena->bytes = (char *)realloc(arena->bytes, capacity);
+        assert(arena->bytes);
+        arena->byteCapacity = capacity;
+    }
+    if (arena->wordCount == arena->wordCapacity) {
+        arena->wordCapacity = arena->wordCapacity ? 2 * arena->wordCapacity
+                                                  : 128;
+        arena->offsets = (int *)realloc(arena->offsets,
+                                        arena->wordCapacity * sizeof(int));
+        assert(arena->offsets);
+    }
+    arena->offsets[arena->wordCount++] = arena->usedBytes;
+    memcpy(arena->bytes + arena->usedBytes, word, length);
+    arena->bytes[arena->usedBytes + length] = '\0';
+    arena->usedBytes += length + 1;
+}
 
-    // Traverse current matrix and find cells equal to 1
-    for (int i = 0; i < dimension; i++) {
-        for (int j = 0; j < dimension; j++) {
-            if (current[i][j] == 1) {
-                // Recur for all connected neighbors
-                for (int k = 0; k < 8; k++) {
-                    int newRow = i + rowNum[k];
-                    int newCol = j + colNum[k];
-                    // Check whether it is in the boundaries and it is not
-                    // visited
-                    if (isSafe(board, newRow, newCol, dimension, visited)) {
-                        // Check if that letter is a subsequent letter in the
-                        // prefix trie
-                        if ((32 + board[newRow][newCol]) == lowercaseLetter) {
-                            // Find all same letters that on the board
-                            next[newRow][newCol] = 1;
-                        }
-                    }
-                }
-            }
+/*
+    Moves the arena words into the solution and frees the arena. The word
+    pointers and the characters share one block, so free(s->words) releases
+    every word of the solution at once.
+*/
+void arenaToSolution(struct wordArena *arena, struct solution *s) {
+    if (arena->wordCount > 0) {
+        size_t tableSize = arena->wordCount * sizeof(char *);
+        char **words = (char **)malloc(tableSize + arena->usedBytes);
+        assert(words);
+        char *bytes = (char *)words + tableSize;
+        memcpy(bytes, arena->bytes, arena->usedBytes);
+        for (int i = 0; i < arena->wordCount; i++) {
+            words[i] = bytes + arena->offsets[i];
         }
+        s->words = words;
+        s->foundWordCount = arena->wordCount;
     }
-    return next;
+    free(arena->bytes);
+    free(arena->offsets);
+    free(arena);
+}
+
+/*
+    Checks that the index are within the dimensions and are not viisted.
+*/
+int isSafe(char **board, int row, int col, int dimension, int **visited) {
+    return (row >= 0) && (row < dimension) && (col >= 0) && (col < dimension) &&
+           (board[row][col] && !visited[row][col]);
 }
 
 /*
     Traverses each cell of the board for finding longest valid word.
 */
-void findLongestWordTraversal(char **board, int dimension, struct prefixTree *tree) {
-    // Matrix to mark visited cells. Initially all cells are unvisited
-    int **visited = createMatrix(dimension, dimension);
-    int **current = createMatrix(dimension, dimension);
+void findLongestWordTraversal(char **board, int dimension,
+                              struct dictionary *d) {
+    struct dfsEngine *engine =
+        newDFSEngine(board, dimension, d, UNIQUE_LETTERS_MODE);
 
     // Traverse through all cells of given matrix
     for (int i = 0; i < dimension; i++) {
         for (int j = 0; j < dimension; j++) {
-            // Reset the visited and current cells at each traversal
-            resetMatrix(visited, dimension, dimension);
-            resetMatrix(current, dimension, dimension);
-
-            // Create a boolean array to store presence of unique characters
-            int builtWord[256] = {0};
-
-            int lowercaseLetter = board[i][j] + 32;
             // Check if that letter is a subsequent letter in the prefix trie
-            if (board[i][j] && !visited[i][j] &&
-                tree->children[lowercaseLetter]) {
-                // Mark the letter as the current letter for the first
-                // iteration of DFS and mark the unique letter to ensure
-                // uniqueness
-                builtWord[lowercaseLetter] = 1;
-                current[i][j] = 1;
+            int child = board[i][j] ? trieChild(d->nodes, 0, board[i][j] + 32)
+                                    : -1;
+            if (child >= 0) {
                 // Visit all cells in this connected component
-                findLongestWordDFS(board, dimension, visited,
-                         tree->children[lowercaseLetter], builtWord, current);
+                iterativeDFS(engine, i, j, child);
             }
         }
     }
+    freeDFSEngine(engine);
 }
 
 /*
@@ -1,7 +1,32 @@
 #include <stdio.h>
 
+struct autocompleteSession;
+struct dictionary;
+
+#ifdef BOGGLE_STATS
+/* Trie nodes entered by the DFS, counted when built with -DBOGGLE_STATS. */
+extern long long boggleNodesVisited;
+#endif
+
 struct solution *findAllValidWords(struct problem *p);
 
 struct solution *autocompletePartialWord(struct problem *p);
 
-struct solution *findLongestValidWord(struct problem *p);
\ No newline at end of file
+struct solution *findLongestValidWord(struct problem *p);
+
+struct solution *findAllValidWordsInDictionary(struct problem *p,
+                                               struct dictionary *d);
+
+struct solution *autocompletePartialWordInDictionary(struct problem *p,
+                                                     struct dictionary *d);
+
+struct solution *findLongestValidWordInDictionary(struct problem *p,
+                                                  struct dictionary *d);
+
+struct autocompleteSession *newAutocompleteSession(struct problem *p);
+
+int extendAutocompleteSession(struct autocompleteSession *session, char letter);
+
+struct solution *sessionFollowLetters(struct autocompleteSession *session);
+
+void freeAutocompleteSession(struct autocompleteSession *session);
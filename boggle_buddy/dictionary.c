@@ -0,0 +1,342 @@
+#include "dictionary.h"
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Identifies a trie file and the version of its layout. */
+#define TRIE_MAGIC "BOGTRIE1"
+
+/* Header of a trie file, followed by the nodes. */
+struct trieFileHeader {
+    char magic[8];
+    uint32_t nodeCount;
+    uint32_t wordCount;
+};
+
+/* The sorted words below a trie node while the trie is laid out, which
+   share their first depth letters. */
+struct wordRange {
+    int start;
+    int end;
+    int depth;
+};
+
+/* Returns a dictionary with no words and an empty trie. */
+struct dictionary *newEmptyDictionary();
+
+/* Builds the trie of a word list into the dictionary. */
+void buildTrie(struct dictionary *d, char **words, int wordCount);
+
+/* Compares two words through pointers to them, for qsort. */
+int compareWords(const void *a, const void *b);
+
+/* Lays out the trie of a sorted word list breadth first. */
+void layoutTrie(struct dictionary *d, char **sorted, int wordCount);
+
+/* Checks the layout of mapped trie nodes, returning the depth of the trie,
+   or -1 if some child range is out of place. */
+int checkTrieLayout(struct trieNode *nodes, int nodeCount);
+
+struct dictionary *loadDictionary(char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = st.st_size;
+
+    /* Reserve one zero byte past the end of the file, so the last word is
+       null terminated even without a trailing newline, then map the file
+       privately over the reservation so it can be tokenized in place. */
+    char *map = mmap(NULL, length + 1, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (length > 0 &&
+        mmap(map, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+             0) == MAP_FAILED) {
+        munmap(map, length + 1);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    madvise(map, length, MADV_SEQUENTIAL);
+
+    struct dictionary *d = newEmptyDictionary();
+    d->map = map;
+    d->mapLength = length + 1;
+
+    /* The first line holds the word count, which sizes the word array. */
+    char *end = map + length;
+    char *cursor = memchr(map, '\n', length);
+    cursor = cursor ? cursor + 1 : end;
+    int capacity = (int)strtol(map, NULL, 10);
+    if (capacity <= 0) {
+        capacity = 1024;
+    }
+    d->words = (char **)malloc(capacity * sizeof(char *));
+    assert(d->words);
+
+    /* memchr is vectorised by common C libraries, so scanning for newlines
+       runs close to memory speed. */
+    while (cursor < end) {
+        char *newline = memchr(cursor, '\n', end - cursor);
+        if (newline == NULL) {
+            newline = end;
+        }
+        char *wordEnd = newline;
+        if (wordEnd > cursor && wordEnd[-1] == '\r') {
+            wordEnd--;
+        }
+        *wordEnd = '\0';
+        if (wordEnd > cursor) {
+            if (d->wordCount == capacity) {
+                capacity *= 2;
+                d->words = (char **)realloc(d->words, capacity * sizeof(char *));
+                assert(d->words);
+            }
+            d->words[d->wordCount++] = cursor;
+        }
+        cursor = newline + 1;
+    }
+    buildTrie(d, d->words, d->wordCount);
+    return d;
+}
+
+struct dictionary *newDictionary(char **words, int wordCount) {
+    struct dictionary *d = newEmptyDictionary();
+    buildTrie(d, words, wordCount);
+    d->wordCount = wordCount;
+    return d;
+}
+
+int saveDictionaryTrie(struct dictionary *d, char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    struct trieFileHeader header;
+    memcpy(header.magic, TRIE_MAGIC, sizeof(header.magic));
+    header.nodeCount = d->nodeCount;
+    header.wordCount = d->wordCount;
+    int written =
+        fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(d->nodes, sizeof(struct trieNode), d->nodeCount, file) ==
+            (size_t)d->nodeCount;
+    if (fclose(file) != 0 || !written) {
+        return -1;
+    }
+    return 0;
+}
+
+struct dictionary *loadDictionaryTrie(char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 ||
+        (size_t)st.st_size < sizeof(struct trieFileHeader)) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = st.st_size;
+    char *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    struct trieFileHeader header;
+    memcpy(&header, map, sizeof(header));
+    int depth = -1;
+    if (memcmp(header.magic, TRIE_MAGIC, sizeof(header.magic)) == 0 &&
+        header.nodeCount > 0 && header.nodeCount <= INT32_MAX &&
+        length == sizeof(header) +
+                      (size_t)header.nodeCount * sizeof(struct trieNode)) {
+        depth = checkTrieLayout(
+            (struct trieNode *)(map + sizeof(header)), header.nodeCount);
+    }
+    if (depth < 0) {
+        munmap(map, length);
+        return NULL;
+    }
+
+    struct dictionary *d = newEmptyDictionary();
+    d->map = map;
+    d->mapLength = length;
+    d->wordCount = header.wordCount;
+    d->nodes = (struct trieNode *)(map + sizeof(header));
+    d->nodeCount = header.nodeCount;
+    d->nodesMapped = 1;
+    d->longestWord = depth;
+    d->marks = (unsigned char *)calloc(d->nodeCount, 1);
+    assert(d->marks);
+    return d;
+}
+
+void freeDictionary(struct dictionary *d) {
+    if (!d->nodesMapped) {
+        free(d->nodes);
+    }
+    free(d->marks);
+    free(d->words);
+    if (d->map) {
+        munmap(d->map, d->mapLength);
+    }
+    free(d);
+}
+
+struct dictionary *newEmptyDictionary() {
+    struct dictionary *d =
+        (struct dictionary *)malloc(sizeof(struct dictionary));
+    assert(d);
+    d->map = NULL;
+    d->mapLength = 0;
+    d->words = NULL;
+    d->wordCount = 0;
+    d->nodes = NULL;
+    d->nodeCount = 0;
+    d->nodesMapped = 0;
+    d->longestWord = 0;
+    d->marks = NULL;
+    return d;
+}
+
+/*
+    Word lists are usually sorted already, in which case a single pass
+    checks it and the words are laid out as they are. Otherwise they are
+    laid out through a sorted copy of the pointers.
+*/
+void buildTrie(struct dictionary *d, char **words, int wordCount) {
+    char **sorted = words;
+    for (int i = 1; i < wordCount; i++) {
+        if (strcmp(words[i - 1], words[i]) > 0) {
+            sorted = (char **)malloc(wordCount * sizeof(char *));
+            assert(sorted);
+            memcpy(sorted, words, wordCount * sizeof(char *));
+            qsort(sorted, wordCount, sizeof(char *), compareWords);
+            break;
+        }
+    }
+
+    layoutTrie(d, sorted, wordCount);
+    if (sorted != words) {
+        free(sorted);
+    }
+}
+
+int compareWords(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/*
+    Each node stands for the range of sorted words sharing its prefix, so
+    its children are the runs of equal letters at its depth, found in one
+    scan of the range and placed together at the end of the nodes. Placing
+    them in node order lays the trie out breadth first, and each level
+    reads the words in order.
+*/
+void layoutTrie(struct dictionary *d, char **sorted, int wordCount) {
+    int capacity = 1024;
+    d->nodes = (struct trieNode *)malloc(capacity * sizeof(struct trieNode));
+    struct wordRange *ranges =
+        (struct wordRange *)malloc(capacity * sizeof(struct wordRange));
+    assert(d->nodes && ranges);
+    d->nodes[0].letter = 0;
+    ranges[0].start = 0;
+    ranges[0].end = wordCount;
+    ranges[0].depth = 0;
+    int nodeCount = 1;
+
+    for (int i = 0; i < nodeCount; i++) {
+        int start = ranges[i].start;
+        int end = ranges[i].end;
+        int depth = ranges[i].depth;
+        d->nodes[i].firstChild = nodeCount;
+        d->nodes[i].terminal = 0;
+        /* Words ending at this node sort before the ones going on. */
+        while (start < end && sorted[start][depth] == '\0') {
+            d->nodes[i].terminal = 1;
+            start++;
+        }
+        while (start < end) {
+            unsigned char letter = sorted[start][depth];
+            int next = start + 1;
+            while (next < end && (unsigned char)sorted[next][depth] == letter) {
+                next++;
+            }
+            if (nodeCount == capacity) {
+                capacity *= 2;
+                d->nodes = (struct trieNode *)realloc(
+                    d->nodes, capacity * sizeof(struct trieNode));
+                ranges = (struct wordRange *)realloc(
+                    ranges, capacity * sizeof(struct wordRange));
+                assert(d->nodes && ranges);
+            }
+            d->nodes[nodeCount].letter = letter;
+            ranges[nodeCount].start = start;
+            ranges[nodeCount].end = next;
+            ranges[nodeCount].depth = depth + 1;
+            nodeCount++;
+            start = next;
+        }
+        d->nodes[i].childCount = nodeCount - d->nodes[i].firstChild;
+    }
+
+    /* The last node is one of the deepest, and a leaf ends a word. */
+    d->longestWord = ranges[nodeCount - 1].depth;
+    d->nodeCount = nodeCount;
+    d->marks = (unsigned char *)calloc(nodeCount, 1);
+    assert(d->marks);
+    free(ranges);
+}
+
+/*
+    A valid trie file is exactly what layoutTrie produces: the children of
+    each node follow those of the node before it, with increasing non-zero
+    letters, and every node but the root comes after its parent, so each
+    node has one parent and lies deeper than it. Searches can then follow
+    child indices without bounds checks. The depth goes up by one each time
+    the scan reaches the end of a level.
+*/
+int checkTrieLayout(struct trieNode *nodes, int nodeCount) {
+    uint32_t placed = 1;
+    uint32_t levelEnd = 1;
+    int depth = 0;
+    for (int i = 0; i < nodeCount; i++) {
+        if ((uint32_t)i == levelEnd) {
+            depth++;
+            levelEnd = placed;
+        }
+        if ((i > 0 && (uint32_t)i >= placed) ||
+            nodes[i].firstChild != placed ||
+            nodes[i].childCount > (uint32_t)nodeCount - placed) {
+            return -1;
+        }
+        for (uint32_t child = placed; child < placed + nodes[i].childCount;
+             child++) {
+            if (nodes[child].letter == 0 ||
+                (child > placed &&
+                 nodes[child].letter <= nodes[child - 1].letter)) {
+                return -1;
+            }
+        }
+        placed += nodes[i].childCount;
+    }
+    if (placed != (uint32_t)nodeCount || nodes[0].letter != 0) {
+        return -1;
+    }
+    return depth;
+}
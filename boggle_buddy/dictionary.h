@@ -0,0 +1,63 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef DICTIONARYSTRUCT
+#define DICTIONARYSTRUCT
+
+/* Marks left in a dictionary by a search, one byte per trie node. */
+#define NODE_MARKED (1)
+#define WORD_MARKED (2)
+
+/* A node of the compact trie. Nodes are stored breadth first from the root,
+   so the children of a node are contiguous and sorted by letter, and a
+   node only needs the index of its first child. Trie files hold the same
+   8 byte nodes, in the byte order of the machine that wrote them. */
+struct trieNode {
+    uint32_t firstChild;
+    uint16_t childCount;
+    /* Letter on the edge from the parent, 0 for the root. */
+    uint8_t letter;
+    /* Non-zero when a word ends at this node. */
+    uint8_t terminal;
+};
+
+struct dictionary {
+    /* The mapped file, either a word list tokenized in place or a trie
+       file. NULL for a dictionary built from an in-memory word list. */
+    char *map;
+    size_t mapLength;
+    /* Words pointing into the mapping, in file order. Only a word list
+       has them; a trie file just records how many words it holds. */
+    char **words;
+    int wordCount;
+    /* The trie, root first. Points into the mapping for a trie file. */
+    struct trieNode *nodes;
+    int nodeCount;
+    int nodesMapped;
+    /* Length of the longest word, which bounds the depth of the trie. */
+    int longestWord;
+    /* Search marks, one byte per node, all clear between searches. */
+    unsigned char *marks;
+};
+
+#endif
+
+/* Maps a dictionary file and builds its compact trie from the mapped words.
+   Returns NULL if the file cannot be opened or mapped. */
+struct dictionary *loadDictionary(char *path);
+
+/* Builds a dictionary from an in-memory word list. The words are only read
+   while building, so they may be freed afterwards. */
+struct dictionary *newDictionary(char **words, int wordCount);
+
+/* Writes the compact trie of a dictionary to a trie file. Returns 0 on
+   success and -1 if the file cannot be written. */
+int saveDictionaryTrie(struct dictionary *d, char *path);
+
+/* Maps a trie file written by saveDictionaryTrie. The nodes are searched
+   straight from the mapping, so loading only checks the layout. Returns
+   NULL if the file cannot be mapped or is not a valid trie file. */
+struct dictionary *loadDictionaryTrie(char *path);
+
+/* Unmaps the dictionary and frees its words, trie and marks. */
+void freeDictionary(struct dictionary *d);
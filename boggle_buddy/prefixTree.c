@@ -46,6 +46,7 @@ void freePrefixTree(struct prefixTree* node) {
             continue;
         }
     }
+    free(node->data);
     free(node);
 }
 
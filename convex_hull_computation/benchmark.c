@@ -0,0 +1,415 @@
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "problem.h"
+#include "convexHull.h"
+#include "incrementalHull.h"
+#include "linkedList.h"
+#include "outOfCoreHull.h"
+
+/* Point counts benchmarked, up to the limit given on the command line. */
+static const int pointCounts[] = {1000,    10000,    100000,
+                                  1000000, 10000000, 100000000};
+#define POINT_COUNT_COUNT (sizeof(pointCounts) / sizeof(pointCounts[0]))
+
+/* Point distributions: uniform in a square, whose hull has O(log n) points,
+   uniform in a disk, whose hull has O(n^(1/3)) points, on a circle, where
+   nearly every point is on the hull and Jarvis' March takes quadratic time,
+   Gaussian, whose hull has O(sqrt(log n)) points, on four lines through
+   integer points, which is mostly collinear and repeated points, and drawn
+   from only a few distinct points. */
+#define DISTRIBUTION_SQUARE 0
+#define DISTRIBUTION_DISK 1
+#define DISTRIBUTION_CIRCLE 2
+#define DISTRIBUTION_GAUSSIAN 3
+#define DISTRIBUTION_COLLINEAR 4
+#define DISTRIBUTION_DUPLICATES 5
+#define DISTRIBUTION_COUNT 6
+static const char *distributionNames[] = {"square",   "disk",      "circle",
+                                          "gaussian", "collinear", "duplicates"};
+
+/* Distinct points in the duplicates distribution. */
+#define DUPLICATE_POINTS 64
+
+/* Algorithms benchmarked, in the order they are run. */
+#define ALGORITHM_JARVIS 0
+#define ALGORITHM_GRAHAM 1
+#define ALGORITHM_CHAN 2
+#define ALGORITHM_MONOTONE 3
+#define ALGORITHM_PARALLEL 4
+#define ALGORITHM_DOUBLE 5
+#define ALGORITHM_INCREMENTAL 6
+#define ALGORITHM_OUT_OF_CORE 7
+#define ALGORITHM_COUNT 8
+static const char *algorithmNames[] = {"jarvis",   "graham", "chan",
+                                       "monotone", "parallel", "double",
+                                       "incremental", "outofcore"};
+
+/* What each algorithm counts as an operation. */
+static const char *operationNames[] = {
+    "orientation tests",     "angle comparisons",
+    "comparisons and tests", "point comparisons",
+    "point comparisons",     "point comparisons",
+    "hull changes",          "point comparisons"};
+
+/* An algorithm run on its own thread, since grahamScan keeps its index and
+   merge arrays on the stack and needs more than the default for large
+   inputs. */
+struct benchmarkRun {
+    int algorithm;
+    int cull;
+    struct problem *p;
+    /* Binary point file holding the same points, for outOfCoreHull. */
+    char *pointFile;
+    int hullSize;
+    long long operationCount;
+    /* Allocations made by the algorithm and the bytes they asked for. */
+    unsigned long long allocations;
+    unsigned long long allocatedBytes;
+};
+
+#ifdef __GLIBC__
+/* Every allocation of the program goes through these, which count them and
+   pass them on to the C library's allocator. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+
+static unsigned long long allocationCount = 0;
+static unsigned long long allocationBytes = 0;
+
+void *malloc(size_t size) {
+    __atomic_add_fetch(&allocationCount, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&allocationBytes, size, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    __atomic_add_fetch(&allocationCount, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&allocationBytes, count * size, __ATOMIC_RELAXED);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    __atomic_add_fetch(&allocationCount, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&allocationBytes, size, __ATOMIC_RELAXED);
+    return __libc_realloc(pointer, size);
+}
+#define ALLOCATION_COUNT() __atomic_load_n(&allocationCount, __ATOMIC_RELAXED)
+#define ALLOCATION_BYTES() __atomic_load_n(&allocationBytes, __ATOMIC_RELAXED)
+#else
+#define ALLOCATION_COUNT() 0ULL
+#define ALLOCATION_BYTES() 0ULL
+#endif
+
+/* Returns the next value of a xorshift generator, so points only depend on
+   the seed and not on the C library. */
+unsigned long long nextRandom(unsigned long long *state);
+
+/* Returns a random value uniformly distributed in [0, 1). */
+long double randomUnit(unsigned long long *state);
+
+/* Fills the problem with random points from the given distribution. */
+void generatePoints(struct problem *p, int distribution,
+                    unsigned long long *state);
+
+/* Writes the points of a problem to a new binary point file, returning its
+   path, or NULL if it cannot be written. */
+char *writePointFile(struct problem *p);
+
+/* Runs the algorithm of a benchmark run, recording its hull size, operation
+   count and allocations. */
+void *runAlgorithm(void *arg);
+
+/* Returns the elapsed time between two timestamps in milliseconds. */
+double elapsedMs(struct timespec *start, struct timespec *end);
+
+int main(int argc, char **argv) {
+    unsigned long long seed = 1;
+    int maxPoints = 1000000;
+    /* Jarvis' March takes O(nh) time, so it is skipped once the number of
+       points times the hull size exceeds this. */
+    long long jarvisBudget = 1000000000LL;
+    /* With -cull, interior points are discarded before each algorithm runs,
+       and the time taken is included. */
+    int cull = 0;
+    /* With -csv, each result is printed as a comma separated line starting
+       with the time of the run, so the output can be appended to a file to
+       track the results over time. */
+    int csv = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-max") == 0 && i + 1 < argc) {
+            maxPoints = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-jarvis") == 0 && i + 1 < argc) {
+            jarvisBudget = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "-cull") == 0) {
+            cull = 1;
+        } else if (strcmp(argv[i], "-csv") == 0) {
+            csv = 1;
+        } else {
+            fprintf(stderr,
+                    "usage: %s [-seed n] [-max points] [-jarvis budget] "
+                    "[-cull] [-csv]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    long long runTime = (long long)time(NULL);
+    if (!csv) {
+        printf("%10s %10s %11s %9s %9s %11s %12s %10s %12s\n", "points",
+               "dist", "algorithm", "kept", "hull", "ms", "ops", "allocs",
+               "bytes");
+    }
+
+    for (int d = 0; d < DISTRIBUTION_COUNT; d++) {
+        for (int i = 0; i < (int)POINT_COUNT_COUNT; i++) {
+            if (pointCounts[i] > maxPoints) {
+                break;
+            }
+            unsigned long long start = seed ? seed : 1;
+            struct problem p;
+            p.numPoints = pointCounts[i];
+            p.pointsX = (long double *)malloc(p.numPoints * sizeof(long double));
+            assert(p.pointsX);
+            p.pointsY = (long double *)malloc(p.numPoints * sizeof(long double));
+            assert(p.pointsY);
+            unsigned long long state = start;
+            generatePoints(&p, d, &state);
+            char *pointFile = writePointFile(&p);
+
+            /* The hull size decides whether Jarvis' March fits its budget. */
+            struct hullArray *reference = monotoneChain(&p, HULL_ORDER_JARVIS);
+            long long jarvisWork = (long long)p.numPoints * reference->numPoints;
+            freeHullArray(reference);
+
+            for (int a = 0; a < ALGORITHM_COUNT; a++) {
+                if ((a == ALGORITHM_JARVIS && jarvisWork > jarvisBudget) ||
+                    (a == ALGORITHM_OUT_OF_CORE && pointFile == NULL)) {
+                    if (!csv) {
+                        printf("%10d %10s %11s %9s %9s %11s %12s %10s %12s\n",
+                               pointCounts[i], distributionNames[d],
+                               algorithmNames[a], "-", "-", "-", "-", "-", "-");
+                    }
+                    continue;
+                }
+
+                /* grahamScan moves the lowest point to the front and culling
+                   drops points, so each run gets freshly generated points. */
+                if (a > 0) {
+                    p.numPoints = pointCounts[i];
+                    state = start;
+                    generatePoints(&p, d, &state);
+                }
+
+                struct benchmarkRun run = {a, cull, &p, pointFile, 0, 0, 0, 0};
+                pthread_attr_t attr;
+                pthread_attr_init(&attr);
+                pthread_attr_setstacksize(&attr,
+                                          (size_t)p.numPoints * 32 + (8 << 20));
+                pthread_t thread;
+                struct timespec begin, end;
+                clock_gettime(CLOCK_MONOTONIC, &begin);
+                pthread_create(&thread, &attr, runAlgorithm, &run);
+                pthread_join(thread, NULL);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                pthread_attr_destroy(&attr);
+
+                double ms = elapsedMs(&begin, &end);
+                if (csv) {
+                    printf("%lld,%llu,%d,%s,%s,%d,%d,%.3f,%lld,%llu,%llu\n",
+                           runTime, seed, pointCounts[i], distributionNames[d],
+                           algorithmNames[a], p.numPoints, run.hullSize, ms,
+                           run.operationCount, run.allocations,
+                           run.allocatedBytes);
+                } else {
+                    printf("%10d %10s %11s %9d %9d %11.3f %12lld %10llu "
+                           "%12llu\n",
+                           pointCounts[i], distributionNames[d],
+                           algorithmNames[a], p.numPoints, run.hullSize, ms,
+                           run.operationCount, run.allocations,
+                           run.allocatedBytes);
+                }
+                fflush(stdout);
+            }
+
+            if (pointFile) {
+                unlink(pointFile);
+                free(pointFile);
+            }
+            free(p.pointsX);
+            free(p.pointsY);
+        }
+    }
+    if (!csv) {
+        printf("(times in ms; kept is the number of points left after culling; "
+               "ops are");
+        for (int a = 0; a < ALGORITHM_COUNT; a++) {
+            printf("%s %s for %s", a == 0 ? "" : ",", operationNames[a],
+                   algorithmNames[a]);
+        }
+        printf("; allocs and bytes count calls to malloc, calloc and realloc "
+               "during the run)\n");
+    }
+    return 0;
+}
+
+unsigned long long nextRandom(unsigned long long *state) {
+    unsigned long long x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+long double randomUnit(unsigned long long *state) {
+    return (nextRandom(state) >> 11) * (1.0L / 9007199254740992.0L);
+}
+
+void generatePoints(struct problem *p, int distribution,
+                    unsigned long long *state) {
+    /* The duplicates are drawn from points fixed by the first few values. */
+    long double duplicatesX[DUPLICATE_POINTS];
+    long double duplicatesY[DUPLICATE_POINTS];
+    if (distribution == DISTRIBUTION_DUPLICATES) {
+        for (int i = 0; i < DUPLICATE_POINTS; i++) {
+            duplicatesX[i] = floorl(randomUnit(state) * 2000) - 1000;
+            duplicatesY[i] = floorl(randomUnit(state) * 2000) - 1000;
+        }
+    }
+
+    for (int i = 0; i < p->numPoints; i++) {
+        long double x, y;
+        if (distribution == DISTRIBUTION_CIRCLE) {
+            long double angle = randomUnit(state) * 2 * 3.14159265358979323846L;
+            x = cosl(angle);
+            y = sinl(angle);
+        } else if (distribution == DISTRIBUTION_GAUSSIAN) {
+            /* The Box-Muller transform, with a deviation of a third. */
+            long double radius = sqrtl(-2 * logl(1 - randomUnit(state)));
+            long double angle = randomUnit(state) * 2 * 3.14159265358979323846L;
+            x = radius * cosl(angle) / 3;
+            y = radius * sinl(angle) / 3;
+        } else if (distribution == DISTRIBUTION_COLLINEAR) {
+            /* Integer points on two sides and both diagonals of a square. */
+            long double t = floorl(randomUnit(state) * 1001) / 500 - 1;
+            int line = (int)(nextRandom(state) % 4);
+            x = line == 3 ? -1 : t;
+            y = line == 0 ? t : (line == 1 ? -t : (line == 2 ? -1 : t));
+        } else if (distribution == DISTRIBUTION_DUPLICATES) {
+            int pick = (int)(nextRandom(state) % DUPLICATE_POINTS);
+            p->pointsX[i] = duplicatesX[pick];
+            p->pointsY[i] = duplicatesY[pick];
+            continue;
+        } else {
+            do {
+                x = randomUnit(state) * 2 - 1;
+                y = randomUnit(state) * 2 - 1;
+                /* Rejection sampling keeps the disk uniform. */
+            } while (distribution == DISTRIBUTION_DISK && x * x + y * y >= 1);
+        }
+        p->pointsX[i] = x * 1000;
+        p->pointsY[i] = y * 1000;
+    }
+}
+
+char *writePointFile(struct problem *p) {
+    char *path = strdup("/tmp/hullBenchmarkXXXXXX");
+    assert(path);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        free(path);
+        return NULL;
+    }
+    FILE *file = fdopen(fd, "wb");
+    assert(file);
+
+    struct pointFileHeader header;
+    memcpy(header.magic, POINT_FILE_MAGIC, sizeof(header.magic));
+    header.numPoints = p->numPoints;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int i = 0; ok && i < p->numPoints; i++) {
+        struct doublePoint point = {(double)p->pointsX[i], (double)p->pointsY[i]};
+        ok = fwrite(&point, sizeof(point), 1, file) == 1;
+    }
+    if (fclose(file) != 0 || !ok) {
+        unlink(path);
+        free(path);
+        return NULL;
+    }
+    return path;
+}
+
+void *runAlgorithm(void *arg) {
+    struct benchmarkRun *run = (struct benchmarkRun *)arg;
+    unsigned long long allocations = ALLOCATION_COUNT();
+    unsigned long long allocatedBytes = ALLOCATION_BYTES();
+    if (run->cull) {
+        cullInteriorPoints(run->p);
+    }
+
+    struct solution *s = NULL;
+    struct hullArray *hull = NULL;
+    if (run->algorithm == ALGORITHM_DOUBLE) {
+        struct doublePoint *points = toDoublePoints(run->p);
+        struct doublePoint *chain = (struct doublePoint *)malloc(
+            (run->p->numPoints + 1) * sizeof(struct doublePoint));
+        assert(chain);
+        long long operationCount = 0;
+        run->hullSize = monotoneChainDouble(points, run->p->numPoints,
+                                            HULL_ORDER_JARVIS, chain,
+                                            &operationCount);
+        run->operationCount = operationCount;
+        free(points);
+        free(chain);
+    } else if (run->algorithm == ALGORITHM_INCREMENTAL) {
+        struct incrementalHull *incremental = newIncrementalHull();
+        run->operationCount = insertProblemPoints(incremental, run->p);
+        run->hullSize = incrementalHullSize(incremental);
+        freeIncrementalHull(incremental);
+    } else if (run->algorithm == ALGORITHM_MONOTONE) {
+        hull = monotoneChain(run->p, HULL_ORDER_JARVIS);
+    } else if (run->algorithm == ALGORITHM_OUT_OF_CORE) {
+        /* The file holds every point, so culling does not apply. */
+        hull = outOfCoreHull(run->pointFile, 0, HULL_ORDER_JARVIS);
+    } else if (run->algorithm == ALGORITHM_JARVIS) {
+        s = jarvisMarch(run->p);
+    } else if (run->algorithm == ALGORITHM_GRAHAM) {
+        s = grahamScan(run->p);
+    } else if (run->algorithm == ALGORITHM_CHAN) {
+        s = chansAlgorithm(run->p);
+    } else {
+        s = parallelHull(run->p, 0);
+    }
+    if (hull) {
+        run->hullSize = hull->numPoints;
+        run->operationCount = hull->operationCount;
+        freeHullArray(hull);
+    }
+    run->allocations = ALLOCATION_COUNT() - allocations;
+    run->allocatedBytes = ALLOCATION_BYTES() - allocatedBytes;
+
+    if (s) {
+        run->operationCount = s->operationCount;
+        if (s->convexHull) {
+            run->hullSize = listLength(s->convexHull);
+            freeList(s->convexHull);
+        }
+        free(s);
+    }
+    return NULL;
+}
+
+double elapsedMs(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e3 +
+           (end->tv_nsec - start->tv_nsec) / 1e6;
+}
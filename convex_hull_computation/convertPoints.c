@@ -0,0 +1,19 @@
+#include <stdio.h>
+
+#include "outOfCoreHull.h"
+
+/* Converts a text point file to the binary format read by outOfCoreHull. */
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s points.txt points.bin\n", argv[0]);
+        return 1;
+    }
+    long long numPoints = convertPointFile(argv[1], argv[2]);
+    if (numPoints < 0) {
+        fprintf(stderr, "%s: cannot convert %s to %s\n", argv[0], argv[1],
+                argv[2]);
+        return 1;
+    }
+    printf("%lld points written to %s\n", numPoints, argv[2]);
+    return 0;
+}
@@ -6,14 +6,42 @@
 */
 
 #include <assert.h>
+#include <limits.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "convexHull.h"
 #include "linkedList.h"
+#include "predicates.h"
 #include "problem.h"
 
+/* A chunk of points whose hull is computed by one thread of parallelHull. */
+struct hullTask {
+    struct problem *p;
+    int *indexArr;
+    int numPoints;
+    /* Room for numPoints + 1 indices, holding the hull on return. */
+    int *chain;
+    int numHull;
+    long long operationCount;
+};
+
+/* A range of clusters whose hulls are computed by one thread of batchHulls. */
+struct batchTask {
+    struct doublePoint *points;
+    int *offsets;
+    int firstCluster;
+    int lastCluster;
+    int order;
+    struct doublePoint *hulls;
+    /* Hull sizes, written to hullSizes[c] for cluster c. */
+    int *hullSizes;
+};
+
 /* Finds the index of the lowest point in the points1 array. If there are
    multiple lowest points, choose the one with the lowest point in the points2
    array. */
@@ -41,6 +69,108 @@ void merge(struct problem* p, int* arr, int left, int middle, int right,
 void mergeSort(struct problem* p, int* arr, int left, int right,
                struct solution* s);
 
+/* Compares two points by their x coordinates, breaking ties by their y
+   coordinates. Returns a negative value, zero or a positive value. */
+int comparePoints(struct problem *p, int a, int b, long long *operationCount);
+
+/* Sorts an array of point indices by (x, y) using introsort: quicksort with a
+   median of three pivot, heapsort once the recursion gets too deep and
+   insertion sort for short ranges. */
+void sortPoints(struct problem *p, int *arr, int left, int right, int depth,
+                long long *operationCount);
+
+/* Sorts a range of point indices by (x, y), allowing introsort a recursion
+   depth of twice the logarithm of the range length. */
+void sortPointRange(struct problem *p, int *arr, int left, int right,
+                    long long *operationCount);
+
+/* Sorts a short range of point indices by (x, y) using insertion sort. */
+void insertionSortPoints(struct problem *p, int *arr, int left, int right,
+                         long long *operationCount);
+
+/* Sorts a range of point indices by (x, y) using heapsort. */
+void heapSortPoints(struct problem *p, int *arr, int left, int right,
+                    long long *operationCount);
+
+/* Restores the max heap property below the given root of a heap stored in
+   arr[left..left + count - 1]. */
+void siftDownPoints(struct problem *p, int *arr, int left, int root, int count,
+                    long long *operationCount);
+
+/* Builds the lower and then the upper hull chain of points sorted by (x, y),
+   writing the hull counterclockwise from the leftmost point to chain, which
+   must have room for numPoints + 1 indices. Returns the number of hull
+   vertices. Orientation tests are counted if operationCount is not NULL. */
+int buildChains(struct problem *p, int *sorted, int numPoints, int *chain,
+                long long *operationCount);
+
+/* Finds the position of the vertex of a counterclockwise group hull that
+   Chan's algorithm wraps to from the current point, which must not lie
+   inside the group hull. Uses a binary search over the hull, finished by
+   a short local walk which also covers degenerate cases. */
+int findTangent(struct problem *p, int current, int *hull, int numHull,
+                long long *operationCount);
+
+/* Checks whether point should replace candidate as the next point wrapped to
+   from the current point: either point lies counterclockwise of the line
+   from current to candidate, or it is collinear with it and farther away. */
+int isBetterWrap(struct problem *p, int current, int candidate, int point,
+                 long long *operationCount);
+
+/* Returns the squared distance between two points. */
+long double squaredDistance(struct problem *p, int a, int b);
+
+/* Finds the points with the least y, greatest x - y, greatest x, greatest
+   x + y, greatest y, least x - y, least x and least x + y in a single pass,
+   which are in counterclockwise order around the hull. */
+void findExtremes(struct problem *p, int *extremes);
+
+/* Finds where to start reading a counterclockwise hull chain and the step
+   to read it with, so its vertices come out in the given HULL_ORDER. */
+int orderChain(struct problem *p, int *chain, int numHull, int order,
+               int *step);
+
+/* Computes the hull of a chunk of points on its own thread. */
+void *hullTaskThread(void *arg);
+
+/* Returns the orientation of three double precision points with the same
+   codes as orientation: 0 if collinear, 1 if clockwise and 2 if
+   counterclockwise. The result is exact. */
+int orientationDouble(struct doublePoint *a, struct doublePoint *b,
+                      struct doublePoint *c);
+
+/* Compares two double precision points by x and then by y. */
+int compareDoublePoints(struct doublePoint *a, struct doublePoint *b,
+                        long long *operationCount);
+
+/* Sorts a range of double precision points by (x, y) in place using
+   introsort, as sortPoints does for point indices. */
+void sortDoublePoints(struct doublePoint *points, int left, int right,
+                      int depth, long long *operationCount);
+
+/* Sorts a range of double precision points by (x, y) using heapsort. */
+void heapSortDoublePoints(struct doublePoint *points, int left, int right,
+                          long long *operationCount);
+
+/* Restores the max heap property below the given root of a heap of count
+   double precision points. */
+void siftDownDoublePoints(struct doublePoint *heap, int root, int count,
+                          long long *operationCount);
+
+/* Reverses a range of double precision points in place. */
+void reverseDoublePoints(struct doublePoint *points, int left, int right);
+
+/* Allocates a hull array with room for the given number of vertices. */
+struct hullArray *newHullArray(int capacity);
+
+/* Stores a count of operations in a solution, whose operationCount is an
+   int, saturating at INT_MAX rather than overflowing. */
+void setOperationCount(struct solution *s, long long count);
+
+/* Computes the hulls of a range of clusters on its own thread, reusing one
+   pair of scratch arrays for all of them. */
+void *batchTaskThread(void *arg);
+
 /* Perform Jarvis' March to construct a convex hull for the given problem. */
 struct solution *jarvisMarch(struct problem *p) {
     struct linkedList *hull = NULL;
@@ -144,8 +274,10 @@ struct solution *grahamScan(struct problem *p) {
     /* Iterate over the remaining points. */
     for (int i = 3; i < p->numPoints; i++) {
         /* While the current point and the two points below the top of the stack
-         * make a non-left turn, pop the top of the stack. */
-        while (orientation(p, *(int *)secondTop(stackPtr),
+         * make a non-left turn, pop the top of the stack. Points repeating the
+         * lowest point can pop it down to the lowest point alone. */
+        while (secondTop(stackPtr) &&
+               orientation(p, *(int *)secondTop(stackPtr),
                            *(int *)top(stackPtr), indexArr[i]) != 2) {
             pop(stackPtr);
         }
@@ -181,6 +313,536 @@ struct solution *grahamScan(struct problem *p) {
     return s;
 }
 
+/* Perform Andrew's monotone chain to construct a convex hull for the given
+   problem, writing the vertices to a contiguous array in the given order. */
+struct hullArray *monotoneChain(struct problem *p, int order) {
+    /* Ensure there are at least 3 points. */
+    if (p->numPoints < 3) {
+        return newHullArray(0);
+    }
+
+    /* Sort an array of indices by (x, y) once, leaving the input untouched.
+     * Comparing coordinates directly is exact, unlike comparing polar angles
+     * computed with atan2. */
+    int *indexArr = (int *)malloc(p->numPoints * sizeof(int));
+    assert(indexArr);
+    for (int i = 0; i < p->numPoints; i++) {
+        indexArr[i] = i;
+    }
+    long long operationCount = 0;
+    sortPointRange(p, indexArr, 0, p->numPoints - 1, &operationCount);
+
+    /* The chains are built on a flat array of indices used as a stack, which
+     * can hold at most every point plus the closing point. */
+    int *chain = (int *)malloc((p->numPoints + 1) * sizeof(int));
+    assert(chain);
+    int numHull = buildChains(p, indexArr, p->numPoints, chain, NULL);
+    free(indexArr);
+
+    int step = 1;
+    int start = orderChain(p, chain, numHull, order, &step);
+
+    struct hullArray *hull = newHullArray(numHull);
+    hull->numPoints = numHull;
+    hull->operationCount = operationCount;
+    for (int i = 0, current = start; i < numHull; i++) {
+        hull->pointsX[i] = p->pointsX[chain[current]];
+        hull->pointsY[i] = p->pointsY[chain[current]];
+        current = (current + step) % numHull;
+    }
+    free(chain);
+
+    return hull;
+}
+
+/* Free a hull array. */
+void freeHullArray(struct hullArray *hull) {
+    if (hull) {
+        free(hull->pointsX);
+        free(hull->pointsY);
+        free(hull);
+    }
+}
+
+/* Perform Chan's algorithm to construct a convex hull for the given problem. */
+struct solution *chansAlgorithm(struct problem *p) {
+    struct linkedList *hull = NULL;
+    struct solution *s = (struct solution *)malloc(sizeof(struct solution));
+    assert(s);
+    s->operationCount = 0;
+
+    /* Ensure there are at least 3 points. */
+    if (p->numPoints < 3) {
+        s->convexHull = hull;
+        return s;
+    }
+
+    /* Start from the leftmost point, as in Jarvis' March. */
+    int leftmost = findLowest(p->pointsX, p->pointsY, p->numPoints);
+    long long operationCount = 0;
+
+    int *indexArr = (int *)malloc(p->numPoints * sizeof(int));
+    assert(indexArr);
+    for (int i = 0; i < p->numPoints; i++) {
+        indexArr[i] = i;
+    }
+
+    /* Groups have at least 4 points, and each group hull needs one slot
+     * more than its number of points. */
+    int maxGroups = p->numPoints / 4 + 1;
+    int *groupHulls = (int *)malloc((p->numPoints + maxGroups) * sizeof(int));
+    assert(groupHulls);
+    int *groupStart = (int *)malloc(maxGroups * sizeof(int));
+    assert(groupStart);
+    int *groupSize = (int *)malloc(maxGroups * sizeof(int));
+    assert(groupSize);
+
+    /* The position of each point in groupHulls and its group, so the wrap
+     * can step along the group hull of the current point directly. */
+    int *position = (int *)malloc(p->numPoints * sizeof(int));
+    assert(position);
+    int *groupOf = (int *)malloc(p->numPoints * sizeof(int));
+    assert(groupOf);
+    int *wrap = (int *)malloc(p->numPoints * sizeof(int));
+    assert(wrap);
+
+    int numActive = p->numPoints;
+    int numWrap = 0;
+    int finished = 0;
+    for (int round = 3; !finished; round++) {
+        /* Guess the hull size m = 2^(2^round), capped at the number of
+         * points left, where the last guess always succeeds. The first guess
+         * is m = 256, as smaller groups cost more in extra rounds than they
+         * save in the wrap. */
+        int m = numActive;
+        if (round < 5 && (1 << (1 << round)) < numActive) {
+            m = 1 << (1 << round);
+        }
+
+        /* Split the points into groups of m points and find the hull of each
+         * group with the monotone chain. */
+        int numGroups = (numActive + m - 1) / m;
+        int offset = 0;
+        for (int g = 0; g < numGroups; g++) {
+            int left = g * m;
+            int size = m < numActive - left ? m : numActive - left;
+            sortPointRange(p, indexArr, left, left + size - 1,
+                           &operationCount);
+            for (int i = left; i < left + size; i++) {
+                position[indexArr[i]] = -1;
+            }
+
+            groupStart[g] = offset;
+            groupSize[g] = buildChains(p, indexArr + left, size,
+                                       groupHulls + offset,
+                                       &operationCount);
+            for (int i = 0; i < groupSize[g]; i++) {
+                position[groupHulls[offset + i]] = offset + i;
+                groupOf[groupHulls[offset + i]] = g;
+            }
+            offset += size + 1;
+        }
+
+        /* Wrap around the group hulls for at most m steps, taking the best
+         * tangent point of each group as a candidate. */
+        int current = leftmost;
+        numWrap = 0;
+        wrap[numWrap++] = current;
+        for (int step = 0; step < m; step++) {
+            int nextPoint = -1;
+            for (int g = 0; g < numGroups; g++) {
+                int *groupHull = groupHulls + groupStart[g];
+                int candidate = 0;
+                if (position[current] >= 0 && groupOf[current] == g) {
+                    /* The current point is a vertex of this group hull, so the
+                     * next point is the vertex before it counterclockwise. */
+                    int i = position[current] - groupStart[g];
+                    candidate = groupHull[(i + groupSize[g] - 1) % groupSize[g]];
+                } else {
+                    candidate = groupHull[findTangent(p, current, groupHull,
+                                                      groupSize[g],
+                                                      &operationCount)];
+                }
+
+                if (nextPoint < 0 ||
+                    isBetterWrap(p, current, nextPoint, candidate,
+                                 &operationCount)) {
+                    nextPoint = candidate;
+                }
+            }
+
+            /* Stop when we return to the starting point (leftmost). */
+            if (p->pointsX[nextPoint] == p->pointsX[leftmost] &&
+                p->pointsY[nextPoint] == p->pointsY[leftmost]) {
+                finished = 1;
+                break;
+            }
+            current = nextPoint;
+            wrap[numWrap++] = current;
+        }
+
+        if (m == numActive) {
+            finished = 1;
+        }
+
+        /* A point inside its group hull is inside the whole hull, so only the
+         * group hull points are kept for the next guess. */
+        numActive = 0;
+        for (int g = 0; g < numGroups; g++) {
+            for (int i = 0; i < groupSize[g]; i++) {
+                indexArr[numActive++] = groupHulls[groupStart[g] + i];
+            }
+        }
+    }
+
+    /* Copy the wrapped points to the list of points in the convex hull. */
+    hull = newList();
+    for (int i = 0; i < numWrap; i++) {
+        insertTail(hull, p->pointsX[wrap[i]], p->pointsY[wrap[i]]);
+    }
+
+    free(indexArr);
+    free(groupHulls);
+    free(groupStart);
+    free(groupSize);
+    free(position);
+    free(groupOf);
+    free(wrap);
+
+    setOperationCount(s, operationCount);
+    s->convexHull = hull;
+    return s;
+}
+
+/* Construct the convex hull for the given problem on several threads. */
+struct solution *parallelHull(struct problem *p, int numThreads) {
+    struct linkedList *hull = NULL;
+    struct solution *s = (struct solution *)malloc(sizeof(struct solution));
+    assert(s);
+    s->operationCount = 0;
+
+    /* Ensure there are at least 3 points. */
+    if (p->numPoints < 3) {
+        s->convexHull = hull;
+        return s;
+    }
+
+    if (numThreads <= 0) {
+        numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    /* Chunks smaller than this cost more in thread start up than they save. */
+    int minChunk = 1 << 14;
+    if (numThreads > p->numPoints / minChunk) {
+        numThreads = p->numPoints / minChunk;
+    }
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+
+    int *indexArr = (int *)malloc(p->numPoints * sizeof(int));
+    assert(indexArr);
+    for (int i = 0; i < p->numPoints; i++) {
+        indexArr[i] = i;
+    }
+    int *chains = (int *)malloc((p->numPoints + numThreads) * sizeof(int));
+    assert(chains);
+    struct hullTask *tasks =
+        (struct hullTask *)malloc(numThreads * sizeof(struct hullTask));
+    assert(tasks);
+    pthread_t *threads = (pthread_t *)malloc(numThreads * sizeof(pthread_t));
+    assert(threads);
+
+    /* Split the points into one contiguous chunk per thread, and find the
+     * hull of each chunk concurrently with the monotone chain. The first
+     * chunk runs on the calling thread. */
+    for (int t = 0; t < numThreads; t++) {
+        int left = (int)((long long)p->numPoints * t / numThreads);
+        int right = (int)((long long)p->numPoints * (t + 1) / numThreads);
+        tasks[t].p = p;
+        tasks[t].indexArr = indexArr + left;
+        tasks[t].numPoints = right - left;
+        tasks[t].chain = chains + left + t;
+        tasks[t].numHull = 0;
+        tasks[t].operationCount = 0;
+        if (t > 0) {
+            int error = pthread_create(&threads[t], NULL, hullTaskThread,
+                                       &tasks[t]);
+            assert(error == 0);
+        }
+    }
+    hullTaskThread(&tasks[0]);
+    for (int t = 1; t < numThreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    /* Every hull point is on the hull of its chunk, so the hull of the chunk
+     * hulls is the hull of all the points. */
+    int numMerged = 0;
+    long long operationCount = 0;
+    for (int t = 0; t < numThreads; t++) {
+        for (int i = 0; i < tasks[t].numHull; i++) {
+            indexArr[numMerged++] = tasks[t].chain[i];
+        }
+        operationCount += tasks[t].operationCount;
+    }
+    sortPointRange(p, indexArr, 0, numMerged - 1, &operationCount);
+    setOperationCount(s, operationCount);
+    int numHull = buildChains(p, indexArr, numMerged, chains, NULL);
+
+    /* Add the hull points in the order grahamScan gives them. */
+    int step = 1;
+    int current = orderChain(p, chains, numHull, HULL_ORDER_GRAHAM, &step);
+    hull = newList();
+    for (int i = 0; i < numHull; i++) {
+        insertTail(hull, p->pointsX[chains[current]],
+                   p->pointsY[chains[current]]);
+        current = (current + step) % numHull;
+    }
+
+    free(indexArr);
+    free(chains);
+    free(tasks);
+    free(threads);
+
+    s->convexHull = hull;
+    return s;
+}
+
+/* Copy the points of a problem into a new double precision array. */
+struct doublePoint *toDoublePoints(struct problem *p) {
+    struct doublePoint *points =
+        (struct doublePoint *)malloc(p->numPoints * sizeof(struct doublePoint));
+    assert(points);
+    for (int i = 0; i < p->numPoints; i++) {
+        points[i].x = (double)p->pointsX[i];
+        points[i].y = (double)p->pointsY[i];
+    }
+    return points;
+}
+
+/* Perform Andrew's monotone chain on double precision points. */
+int monotoneChainDouble(struct doublePoint *points, int numPoints, int order,
+                        struct doublePoint *hull, long long *operationCount) {
+    long long comparisons = 0;
+
+    /* Ensure there are at least 3 points. */
+    if (numPoints < 3) {
+        return 0;
+    }
+
+    /* Sort the points themselves rather than indices, so the chains read
+     * them in order from memory. */
+    int depth = 0;
+    for (int n = numPoints; n > 1; n >>= 1) {
+        depth += 2;
+    }
+    sortDoublePoints(points, 0, numPoints - 1, depth, &comparisons);
+
+    /* Build the lower and upper chains directly in the output, popping the
+     * top while it does not make an exact left turn with the next point. */
+    int top = 0;
+    for (int i = 0; i < numPoints; i++) {
+        while (top >= 2 &&
+               orientationDouble(&hull[top - 2], &hull[top - 1], &points[i]) != 2) {
+            top--;
+        }
+        hull[top++] = points[i];
+    }
+    int lowerTop = top + 1;
+    for (int i = numPoints - 2; i >= 0; i--) {
+        while (top >= lowerTop &&
+               orientationDouble(&hull[top - 2], &hull[top - 1], &points[i]) != 2) {
+            top--;
+        }
+        hull[top++] = points[i];
+    }
+
+    /* The last point closes the ring back at the leftmost point. */
+    int numHull = top - 1;
+    if (hull[0].x == hull[1].x && hull[0].y == hull[1].y) {
+        /* All the points coincide. */
+        numHull = 1;
+    }
+
+    /* The chain runs counterclockwise from the leftmost point. Reversing all
+     * but the first point gives the clockwise order of Jarvis' March, and
+     * rotating that to the lowest point gives the order of Graham's Scan. */
+    if (order == HULL_ORDER_JARVIS || order == HULL_ORDER_GRAHAM) {
+        reverseDoublePoints(hull, 1, numHull - 1);
+    }
+    if (order == HULL_ORDER_GRAHAM) {
+        int lowest = 0;
+        for (int i = 1; i < numHull; i++) {
+            if (hull[i].y < hull[lowest].y ||
+                (hull[i].y == hull[lowest].y && hull[i].x < hull[lowest].x)) {
+                lowest = i;
+            }
+        }
+        reverseDoublePoints(hull, 0, lowest - 1);
+        reverseDoublePoints(hull, lowest, numHull - 1);
+        reverseDoublePoints(hull, 0, numHull - 1);
+    }
+
+    if (operationCount) {
+        *operationCount = comparisons;
+    }
+    return numHull;
+}
+
+/* Discard every point strictly inside the octagon of extreme points. */
+int cullInteriorPoints(struct problem *p) {
+    if (p->numPoints < 3) {
+        return 0;
+    }
+
+    /* Find the extreme points in eight directions, counterclockwise from the
+     * lowest point. */
+    int extremes[8];
+    findExtremes(p, extremes);
+
+    /* Skip repeated points, which would make zero length edges. */
+    int octagon[8];
+    int numOctagon = 0;
+    for (int i = 0; i < 8; i++) {
+        if (numOctagon == 0 ||
+            p->pointsX[extremes[i]] != p->pointsX[octagon[numOctagon - 1]] ||
+            p->pointsY[extremes[i]] != p->pointsY[octagon[numOctagon - 1]]) {
+            octagon[numOctagon++] = extremes[i];
+        }
+    }
+    while (numOctagon > 1 &&
+           p->pointsX[octagon[numOctagon - 1]] == p->pointsX[octagon[0]] &&
+           p->pointsY[octagon[numOctagon - 1]] == p->pointsY[octagon[0]]) {
+        numOctagon--;
+    }
+    if (numOctagon < 3) {
+        return 0;
+    }
+
+    /* Store the octagon edges by their endpoints, since the points are moved
+     * while they are culled. */
+    long double edgeX[8], edgeY[8], edgeDX[8], edgeDY[8];
+    for (int i = 0; i < numOctagon; i++) {
+        int next = octagon[(i + 1) % numOctagon];
+        edgeX[i] = p->pointsX[octagon[i]];
+        edgeY[i] = p->pointsY[octagon[i]];
+        edgeDX[i] = p->pointsX[next] - edgeX[i];
+        edgeDY[i] = p->pointsY[next] - edgeY[i];
+    }
+
+    /* A point strictly inside the box bounded by the four diagonal extreme
+     * points is strictly dominated by one of them in every quadrant, so it
+     * lies inside the hull and is discarded with four comparisons. */
+    int lowerRight = extremes[1], upperRight = extremes[3];
+    int upperLeft = extremes[5], lowerLeft = extremes[7];
+    long double boxLeft = fmaxl(p->pointsX[upperLeft], p->pointsX[lowerLeft]);
+    long double boxRight = fminl(p->pointsX[upperRight], p->pointsX[lowerRight]);
+    long double boxBottom = fmaxl(p->pointsY[lowerLeft], p->pointsY[lowerRight]);
+    long double boxTop = fminl(p->pointsY[upperLeft], p->pointsY[upperRight]);
+
+    /* Compact the remaining points to the front of the arrays in a single
+     * pass, keeping their order. Each point is written unconditionally and
+     * the write position only advances if it is kept, so the common case
+     * has no unpredictable branch. */
+    int kept = 0;
+    for (int i = 0; i < p->numPoints; i++) {
+        long double x = p->pointsX[i];
+        long double y = p->pointsY[i];
+        int inside = (x > boxLeft) & (x < boxRight) & (y > boxBottom) &
+                     (y < boxTop);
+        if (!inside) {
+            /* Check the octagon itself, which contains the point if it is
+             * strictly left of every edge. */
+            inside = 1;
+            for (int e = 0; e < numOctagon && inside; e++) {
+                inside = edgeDX[e] * (y - edgeY[e]) -
+                             edgeDY[e] * (x - edgeX[e]) > 0;
+            }
+        }
+        p->pointsX[kept] = x;
+        p->pointsY[kept] = y;
+        kept += !inside;
+    }
+
+    int culled = p->numPoints - kept;
+    p->numPoints = kept;
+    return culled;
+}
+
+/* Construct the convex hulls of many clusters of points at once. */
+int batchHulls(struct doublePoint *points, int *offsets, int numClusters,
+               int order, int numThreads, struct doublePoint *hulls,
+               int *hullOffsets) {
+    hullOffsets[0] = 0;
+    if (numClusters <= 0) {
+        return 0;
+    }
+    int totalPoints = offsets[numClusters] - offsets[0];
+
+    if (numThreads <= 0) {
+        numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    /* Ranges smaller than this cost more in thread start up than they save. */
+    int minRange = 1 << 14;
+    if (numThreads > totalPoints / minRange) {
+        numThreads = totalPoints / minRange;
+    }
+    if (numThreads > numClusters) {
+        numThreads = numClusters;
+    }
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+
+    struct batchTask *tasks =
+        (struct batchTask *)malloc(numThreads * sizeof(struct batchTask));
+    assert(tasks);
+    pthread_t *threads = (pthread_t *)malloc(numThreads * sizeof(pthread_t));
+    assert(threads);
+
+    /* Split the clusters into contiguous ranges of about the same number of
+     * points, one per thread. Each hull is first written at the offset of
+     * its cluster, which has room for it, so the threads never share any
+     * output. The first range runs on the calling thread. */
+    int cluster = 0;
+    for (int t = 0; t < numThreads; t++) {
+        long long target =
+            offsets[0] + (long long)totalPoints * (t + 1) / numThreads;
+        tasks[t].points = points;
+        tasks[t].offsets = offsets;
+        tasks[t].firstCluster = cluster;
+        while (cluster < numClusters &&
+               (t == numThreads - 1 || offsets[cluster + 1] <= target)) {
+            cluster++;
+        }
+        tasks[t].lastCluster = cluster;
+        tasks[t].order = order;
+        tasks[t].hulls = hulls;
+        tasks[t].hullSizes = hullOffsets + 1;
+        if (t > 0) {
+            int error = pthread_create(&threads[t], NULL, batchTaskThread,
+                                       &tasks[t]);
+            assert(error == 0);
+        }
+    }
+    batchTaskThread(&tasks[0]);
+    for (int t = 1; t < numThreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(tasks);
+    free(threads);
+
+    /* Turn the hull sizes into offsets and pack the hulls together. Each hull
+     * only moves towards the front, past hulls which have already moved. */
+    for (int c = 0; c < numClusters; c++) {
+        int numHull = hullOffsets[c + 1];
+        hullOffsets[c + 1] = hullOffsets[c] + numHull;
+        memmove(hulls + hullOffsets[c], hulls + (offsets[c] - offsets[0]),
+                numHull * sizeof(struct doublePoint));
+    }
+    return hullOffsets[numClusters];
+}
+
 int findLowest(long double *points1, long double *points2, int numPoints) {
     int minIndex = 0;
 
@@ -315,3 +977,535 @@ void *secondTop(struct stack **s) {
     push(s, item1);
     return item2;
 }
+
+int comparePoints(struct problem *p, int a, int b, long long *operationCount) {
+    (*operationCount)++;
+    if (p->pointsX[a] != p->pointsX[b]) {
+        return p->pointsX[a] < p->pointsX[b] ? -1 : 1;
+    }
+    if (p->pointsY[a] != p->pointsY[b]) {
+        return p->pointsY[a] < p->pointsY[b] ? -1 : 1;
+    }
+    return 0;
+}
+
+void sortPoints(struct problem *p, int *arr, int left, int right, int depth,
+                long long *operationCount) {
+    while (right - left > 16) {
+        /* Fall back to heapsort when the pivots keep splitting badly, so the
+         * sort stays O(n log n). */
+        if (depth == 0) {
+            heapSortPoints(p, arr, left, right, operationCount);
+            return;
+        }
+        depth--;
+
+        /* Order the first, middle and last points, so the middle one can be
+         * used as the pivot and the ends act as sentinels. */
+        int middle = left + (right - left) / 2;
+        int temp = 0;
+        if (comparePoints(p, arr[middle], arr[left], operationCount) < 0) {
+            temp = arr[middle], arr[middle] = arr[left], arr[left] = temp;
+        }
+        if (comparePoints(p, arr[right], arr[middle], operationCount) < 0) {
+            temp = arr[right], arr[right] = arr[middle], arr[middle] = temp;
+            if (comparePoints(p, arr[middle], arr[left], operationCount) < 0) {
+                temp = arr[middle], arr[middle] = arr[left], arr[left] = temp;
+            }
+        }
+        int pivot = arr[middle];
+
+        /* Partition the range around the pivot. */
+        int i = left, j = right;
+        while (i <= j) {
+            while (comparePoints(p, arr[i], pivot, operationCount) < 0) {
+                i++;
+            }
+            while (comparePoints(p, pivot, arr[j], operationCount) < 0) {
+                j--;
+            }
+            if (i <= j) {
+                temp = arr[i], arr[i] = arr[j], arr[j] = temp;
+                i++;
+                j--;
+            }
+        }
+
+        /* Recurse into the smaller side and loop on the larger one, which
+         * bounds the recursion depth by log n. */
+        if (j - left < right - i) {
+            sortPoints(p, arr, left, j, depth, operationCount);
+            left = i;
+        } else {
+            sortPoints(p, arr, i, right, depth, operationCount);
+            right = j;
+        }
+    }
+    insertionSortPoints(p, arr, left, right, operationCount);
+}
+
+void insertionSortPoints(struct problem *p, int *arr, int left, int right,
+                         long long *operationCount) {
+    for (int i = left + 1; i <= right; i++) {
+        int current = arr[i];
+        int j = i - 1;
+        while (j >= left &&
+               comparePoints(p, current, arr[j], operationCount) < 0) {
+            arr[j + 1] = arr[j];
+            j--;
+        }
+        arr[j + 1] = current;
+    }
+}
+
+void heapSortPoints(struct problem *p, int *arr, int left, int right,
+                    long long *operationCount) {
+    int count = right - left + 1;
+    for (int root = count / 2 - 1; root >= 0; root--) {
+        siftDownPoints(p, arr, left, root, count, operationCount);
+    }
+    for (int last = count - 1; last > 0; last--) {
+        /* Move the largest point to the end and restore the heap. */
+        int temp = arr[left];
+        arr[left] = arr[left + last];
+        arr[left + last] = temp;
+        siftDownPoints(p, arr, left, 0, last, operationCount);
+    }
+}
+
+void siftDownPoints(struct problem *p, int *arr, int left, int root, int count,
+                    long long *operationCount) {
+    int current = arr[left + root];
+    int child = 2 * root + 1;
+    while (child < count) {
+        if (child + 1 < count &&
+            comparePoints(p, arr[left + child], arr[left + child + 1],
+                          operationCount) < 0) {
+            child++;
+        }
+        if (comparePoints(p, current, arr[left + child], operationCount) >= 0) {
+            break;
+        }
+        arr[left + root] = arr[left + child];
+        root = child;
+        child = 2 * root + 1;
+    }
+    arr[left + root] = current;
+}
+
+int buildChains(struct problem *p, int *sorted, int numPoints, int *chain,
+                long long *operationCount) {
+    int top = 0;
+    if (numPoints == 1) {
+        chain[0] = sorted[0];
+        return 1;
+    }
+
+    /* Build the lower chain from left to right, popping the top while it does
+     * not make a left turn with the next point. */
+    for (int i = 0; i < numPoints; i++) {
+        while (top >= 2) {
+            if (operationCount) {
+                (*operationCount)++;
+            }
+            if (orientation(p, chain[top - 2], chain[top - 1], sorted[i]) == 2) {
+                break;
+            }
+            top--;
+        }
+        chain[top++] = sorted[i];
+    }
+
+    /* Build the upper chain from right to left on top of the lower chain,
+     * never popping into the lower chain. */
+    int lowerTop = top + 1;
+    for (int i = numPoints - 2; i >= 0; i--) {
+        while (top >= lowerTop) {
+            if (operationCount) {
+                (*operationCount)++;
+            }
+            if (orientation(p, chain[top - 2], chain[top - 1], sorted[i]) == 2) {
+                break;
+            }
+            top--;
+        }
+        chain[top++] = sorted[i];
+    }
+
+    /* The last point closes the ring back at the leftmost point. */
+    if (p->pointsX[chain[0]] == p->pointsX[chain[1]] &&
+        p->pointsY[chain[0]] == p->pointsY[chain[1]]) {
+        /* All the points coincide. */
+        return 1;
+    }
+    return top - 1;
+}
+
+struct hullArray *newHullArray(int capacity) {
+    struct hullArray *hull = (struct hullArray *)malloc(sizeof(struct hullArray));
+    assert(hull);
+    hull->numPoints = 0;
+    hull->operationCount = 0;
+    hull->pointsX = NULL;
+    hull->pointsY = NULL;
+    if (capacity > 0) {
+        hull->pointsX = (long double *)malloc(capacity * sizeof(long double));
+        assert(hull->pointsX);
+        hull->pointsY = (long double *)malloc(capacity * sizeof(long double));
+        assert(hull->pointsY);
+    }
+    return hull;
+}
+
+void setOperationCount(struct solution *s, long long count) {
+    s->operationCount = count > INT_MAX ? INT_MAX : (int)count;
+}
+
+int findTangent(struct problem *p, int current, int *hull, int numHull,
+                long long *operationCount) {
+    int best = 0;
+
+    /* Binary search for the vertex both of whose neighbours lie clockwise of
+     * the line from the current point, following Sunday's tangent search
+     * for convex polygons. */
+    if (numHull > 3) {
+        int a = 0, b = numHull;
+        int steps = 0;
+        for (int n = numHull; n > 0; n >>= 1) {
+            steps += 2;
+        }
+        while (b - a > 1 && steps-- > 0) {
+            int mid = (a + b) / 2;
+            int next = hull[(mid + 1) % numHull];
+            *operationCount += 2;
+            int downMid = orientation(p, current, next, hull[mid]) == 1;
+            if (orientation(p, current, hull[mid - 1], hull[mid]) == 2 &&
+                !downMid) {
+                a = mid;
+                break;
+            }
+
+            (*operationCount)++;
+            int downA =
+                orientation(p, current, hull[(a + 1) % numHull], hull[a]) == 1;
+            if (downA != downMid) {
+                if (downA) {
+                    b = mid;
+                } else {
+                    a = mid;
+                }
+            } else {
+                (*operationCount)++;
+                int turn = orientation(p, current, hull[a], hull[mid]);
+                if (downA ? turn == 1 : turn == 2) {
+                    b = mid;
+                } else {
+                    a = mid;
+                }
+            }
+        }
+        best = a;
+    }
+
+    /* Walk to a better neighbour until there is none. Seen from a point
+     * outside the hull the vertices only get better up to the tangent point,
+     * so this finishes in a step or two after the search, and it also
+     * covers small hulls and collinear ties. */
+    while (numHull > 1) {
+        int next = (best + 1) % numHull;
+        int prev = (best + numHull - 1) % numHull;
+        if (isBetterWrap(p, current, hull[best], hull[next], operationCount)) {
+            best = next;
+        } else if (isBetterWrap(p, current, hull[best], hull[prev],
+                                operationCount)) {
+            best = prev;
+        } else {
+            break;
+        }
+    }
+    return best;
+}
+
+int isBetterWrap(struct problem *p, int current, int candidate, int point,
+                 long long *operationCount) {
+    (*operationCount)++;
+    int turn = orientation(p, current, candidate, point);
+    if (turn == 2) {
+        return 1;
+    }
+    return turn == 0 && squaredDistance(p, current, point) >
+                            squaredDistance(p, current, candidate);
+}
+
+long double squaredDistance(struct problem *p, int a, int b) {
+    long double dx = p->pointsX[b] - p->pointsX[a];
+    long double dy = p->pointsY[b] - p->pointsY[a];
+    return dx * dx + dy * dy;
+}
+
+void findExtremes(struct problem *p, int *extremes) {
+    long double minY = p->pointsY[0], maxY = minY;
+    long double minX = p->pointsX[0], maxX = minX;
+    long double minSum = minX + minY, maxSum = minSum;
+    long double minDiff = minX - minY, maxDiff = minDiff;
+    for (int i = 0; i < 8; i++) {
+        extremes[i] = 0;
+    }
+
+    for (int i = 1; i < p->numPoints; i++) {
+        long double x = p->pointsX[i];
+        long double y = p->pointsY[i];
+        long double sum = x + y;
+        long double diff = x - y;
+        if (y < minY) {
+            minY = y;
+            extremes[0] = i;
+        }
+        if (diff > maxDiff) {
+            maxDiff = diff;
+            extremes[1] = i;
+        }
+        if (x > maxX) {
+            maxX = x;
+            extremes[2] = i;
+        }
+        if (sum > maxSum) {
+            maxSum = sum;
+            extremes[3] = i;
+        }
+        if (y > maxY) {
+            maxY = y;
+            extremes[4] = i;
+        }
+        if (diff < minDiff) {
+            minDiff = diff;
+            extremes[5] = i;
+        }
+        if (x < minX) {
+            minX = x;
+            extremes[6] = i;
+        }
+        if (sum < minSum) {
+            minSum = sum;
+            extremes[7] = i;
+        }
+    }
+}
+
+void sortPointRange(struct problem *p, int *arr, int left, int right,
+                    long long *operationCount) {
+    int depth = 0;
+    for (int n = right - left + 1; n > 1; n >>= 1) {
+        depth += 2;
+    }
+    sortPoints(p, arr, left, right, depth, operationCount);
+}
+
+int orderChain(struct problem *p, int *chain, int numHull, int order,
+               int *step) {
+    /* The chain runs counterclockwise from the leftmost point. The other
+     * orders walk it backwards, starting from the leftmost point for Jarvis'
+     * March or from the lowest point for Graham's Scan. */
+    int start = 0;
+    *step = 1;
+    if (order == HULL_ORDER_JARVIS || order == HULL_ORDER_GRAHAM) {
+        *step = numHull - 1;
+    }
+    if (order == HULL_ORDER_GRAHAM) {
+        for (int i = 1; i < numHull; i++) {
+            int current = chain[i];
+            int lowest = chain[start];
+            if (p->pointsY[current] < p->pointsY[lowest] ||
+                (p->pointsY[current] == p->pointsY[lowest] &&
+                 p->pointsX[current] < p->pointsX[lowest])) {
+                start = i;
+            }
+        }
+    }
+    return start;
+}
+
+void *hullTaskThread(void *arg) {
+    struct hullTask *task = (struct hullTask *)arg;
+    sortPointRange(task->p, task->indexArr, 0, task->numPoints - 1,
+                   &(task->operationCount));
+    task->numHull = buildChains(task->p, task->indexArr, task->numPoints,
+                                task->chain, NULL);
+    return NULL;
+}
+
+void *batchTaskThread(void *arg) {
+    struct batchTask *task = (struct batchTask *)arg;
+    int *offsets = task->offsets;
+
+    /* Size the scratch arrays for the largest cluster in the range. */
+    int maxPoints = 0;
+    for (int c = task->firstCluster; c < task->lastCluster; c++) {
+        if (offsets[c + 1] - offsets[c] > maxPoints) {
+            maxPoints = offsets[c + 1] - offsets[c];
+        }
+    }
+    if (maxPoints == 0) {
+        for (int c = task->firstCluster; c < task->lastCluster; c++) {
+            task->hullSizes[c] = 0;
+        }
+        return NULL;
+    }
+    struct doublePoint *sorted =
+        (struct doublePoint *)malloc(maxPoints * sizeof(struct doublePoint));
+    assert(sorted);
+    struct doublePoint *chain = (struct doublePoint *)malloc(
+        (maxPoints + 1) * sizeof(struct doublePoint));
+    assert(chain);
+
+    /* The input is left untouched, since monotoneChainDouble sorts the points
+     * it is given. */
+    for (int c = task->firstCluster; c < task->lastCluster; c++) {
+        int numPoints = offsets[c + 1] - offsets[c];
+        memcpy(sorted, task->points + offsets[c],
+               numPoints * sizeof(struct doublePoint));
+        int numHull = monotoneChainDouble(sorted, numPoints, task->order,
+                                          chain, NULL);
+        memcpy(task->hulls + (offsets[c] - offsets[0]), chain,
+               numHull * sizeof(struct doublePoint));
+        task->hullSizes[c] = numHull;
+    }
+
+    free(sorted);
+    free(chain);
+    return NULL;
+}
+
+int orientationDouble(struct doublePoint *a, struct doublePoint *b,
+                      struct doublePoint *c) {
+    double det = orient2d(a->x, a->y, b->x, b->y, c->x, c->y);
+    if (det == 0) {
+        return 0;
+    }
+    return det > 0 ? 2 : 1;
+}
+
+int compareDoublePoints(struct doublePoint *a, struct doublePoint *b,
+                        long long *operationCount) {
+    (*operationCount)++;
+    if (a->x != b->x) {
+        return a->x < b->x ? -1 : 1;
+    }
+    if (a->y != b->y) {
+        return a->y < b->y ? -1 : 1;
+    }
+    return 0;
+}
+
+void sortDoublePoints(struct doublePoint *points, int left, int right,
+                      int depth, long long *operationCount) {
+    struct doublePoint temp;
+    while (right - left > 16) {
+        /* Fall back to heapsort when the pivots keep splitting badly. */
+        if (depth == 0) {
+            heapSortDoublePoints(points, left, right, operationCount);
+            return;
+        }
+        depth--;
+
+        /* Use the median of the first, middle and last points as the pivot. */
+        int middle = left + (right - left) / 2;
+        if (compareDoublePoints(&points[middle], &points[left],
+                                operationCount) < 0) {
+            temp = points[middle], points[middle] = points[left],
+            points[left] = temp;
+        }
+        if (compareDoublePoints(&points[right], &points[middle],
+                                operationCount) < 0) {
+            temp = points[right], points[right] = points[middle],
+            points[middle] = temp;
+            if (compareDoublePoints(&points[middle], &points[left],
+                                    operationCount) < 0) {
+                temp = points[middle], points[middle] = points[left],
+                points[left] = temp;
+            }
+        }
+        struct doublePoint pivot = points[middle];
+
+        /* Partition the range around the pivot. */
+        int i = left, j = right;
+        while (i <= j) {
+            while (compareDoublePoints(&points[i], &pivot, operationCount) < 0) {
+                i++;
+            }
+            while (compareDoublePoints(&pivot, &points[j], operationCount) < 0) {
+                j--;
+            }
+            if (i <= j) {
+                temp = points[i], points[i] = points[j], points[j] = temp;
+                i++;
+                j--;
+            }
+        }
+
+        /* Recurse into the smaller side and loop on the larger one. */
+        if (j - left < right - i) {
+            sortDoublePoints(points, left, j, depth, operationCount);
+            left = i;
+        } else {
+            sortDoublePoints(points, i, right, depth, operationCount);
+            right = j;
+        }
+    }
+
+    /* Finish short ranges with insertion sort. */
+    for (int i = left + 1; i <= right; i++) {
+        temp = points[i];
+        int j = i - 1;
+        while (j >= left &&
+               compareDoublePoints(&temp, &points[j], operationCount) < 0) {
+            points[j + 1] = points[j];
+            j--;
+        }
+        points[j + 1] = temp;
+    }
+}
+
+void heapSortDoublePoints(struct doublePoint *points, int left, int right,
+                          long long *operationCount) {
+    struct doublePoint *heap = points + left;
+    int count = right - left + 1;
+    for (int root = count / 2 - 1; root >= 0; root--) {
+        siftDownDoublePoints(heap, root, count, operationCount);
+    }
+    for (int last = count - 1; last > 0; last--) {
+        /* Move the largest point to the end and restore the heap. */
+        struct doublePoint temp = heap[0];
+        heap[0] = heap[last];
+        heap[last] = temp;
+        siftDownDoublePoints(heap, 0, last, operationCount);
+    }
+}
+
+void siftDownDoublePoints(struct doublePoint *heap, int root, int count,
+                          long long *operationCount) {
+    struct doublePoint current = heap[root];
+    int child = 2 * root + 1;
+    while (child < count) {
+        if (child + 1 < count &&
+            compareDoublePoints(&heap[child], &heap[child + 1],
+                                operationCount) < 0) {
+            child++;
+        }
+        if (compareDoublePoints(&current, &heap[child], operationCount) >= 0) {
+            break;
+        }
+        heap[root] = heap[child];
+        root = child;
+        child = 2 * root + 1;
+    }
+    heap[root] = current;
+}
+
+void reverseDoublePoints(struct doublePoint *points, int left, int right) {
+    while (left < right) {
+        struct doublePoint temp = points[left];
+        points[left++] = points[right];
+        points[right--] = temp;
+    }
+}
@@ -10,6 +10,30 @@
 
 #include "linkedList.h"
 
+/* Vertex orders for hulls written to a contiguous array. */
+/* Counterclockwise from the leftmost point, Andrew's natural order. */
+#define HULL_ORDER_COUNTERCLOCKWISE (0)
+/* Clockwise from the leftmost point, as produced by jarvisMarch. */
+#define HULL_ORDER_JARVIS (1)
+/* Clockwise from the lowest point, as produced by grahamScan. */
+#define HULL_ORDER_GRAHAM (2)
+
+/* A convex hull stored as contiguous vertex arrays. */
+struct hullArray {
+    int numPoints;
+    long double *pointsX;
+    long double *pointsY;
+    /* Number of point comparisons performed during sorting. */
+    long long operationCount;
+};
+
+/* A point in double precision, for the double precision pipeline which
+    halves the memory traffic of long double points. */
+struct doublePoint {
+    double x;
+    double y;
+};
+
 /* Perform Jarvis' March to construct a convex
     hull for the given problem. */
 struct solution *jarvisMarch(struct problem *p);
@@ -18,5 +42,69 @@ struct solution *jarvisMarch(struct problem *p);
     hull for the given problem. */
 struct solution *grahamScan(struct problem *p);
 
+/* Perform Chan's algorithm to construct a convex hull for the given
+    problem in O(n log h) time, where h is the number of hull points.
+    The hull starts from the leftmost point as in jarvisMarch, and
+    collinear boundary points are dropped. */
+struct solution *chansAlgorithm(struct problem *p);
+
+/* Construct the convex hull for the given problem on numThreads threads,
+    or one per online processor if numThreads is not positive. Each thread
+    finds the hull of a contiguous chunk of the points with the monotone
+    chain, and the chunk hulls are merged by a final monotone chain. The
+    hull is returned in the same order as grahamScan, and operationCount
+    is the number of point comparisons performed during sorting, or
+    INT_MAX if there were more. */
+struct solution *parallelHull(struct problem *p, int numThreads);
+
+/* Perform Andrew's monotone chain to construct a convex hull for the
+    given problem. The points are sorted once by (x, y) and the hull
+    vertices are written to a contiguous array in the given order, one
+    of the HULL_ORDER values. Collinear boundary points are dropped, as
+    in grahamScan. */
+struct hullArray *monotoneChain(struct problem *p, int order);
+
+/* Copy the points of a problem into a new array of double precision
+    points, rounding each coordinate to the nearest double. */
+struct doublePoint *toDoublePoints(struct problem *p);
+
+/* Perform Andrew's monotone chain on double precision points, using
+    exact adaptive orientation tests so collinear and nearly collinear
+    points are always classified correctly. The points are sorted in
+    place by (x, y), and the hull vertices are written to hull in the
+    given HULL_ORDER, which needs room for numPoints + 1 points. Returns
+    the number of hull vertices, or 0 for fewer than 3 points. The
+    number of point comparisons is written to operationCount if it is
+    not NULL. */
+int monotoneChainDouble(struct doublePoint *points, int numPoints, int order,
+                        struct doublePoint *hull, long long *operationCount);
+
+/* Discard every point strictly inside the octagon spanned by the extreme
+    points in x, y, x + y and x - y, none of which can be on the hull.
+    The remaining points are moved to the front of pointsX and pointsY,
+    keeping their order, and numPoints is reduced to their count, so
+    any of the hull algorithms can run on them afterwards. Returns the
+    number of points discarded. */
+int cullInteriorPoints(struct problem *p);
+
+/* Construct the convex hulls of many clusters of points on numThreads
+    threads, or one per online processor if numThreads is not positive.
+    The input is in compressed sparse row form: cluster c is points
+    offsets[c] to offsets[c + 1] - 1, so offsets has numClusters + 1
+    entries. The hull of cluster c is written to hulls from
+    hullOffsets[c] to hullOffsets[c + 1] - 1 in the given HULL_ORDER, as
+    by monotoneChainDouble, so clusters of fewer than 3 points have empty
+    hulls. hulls needs room for offsets[numClusters] - offsets[0]
+    points and hullOffsets for numClusters + 1 offsets. The points are
+    not modified, and only one pair of scratch arrays is allocated per
+    thread rather than any memory per hull. Returns the total number of
+    hull points. */
+int batchHulls(struct doublePoint *points, int *offsets, int numClusters,
+               int order, int numThreads, struct doublePoint *hulls,
+               int *hullOffsets);
+
+/* Free a hull array. */
+void freeHullArray(struct hullArray *hull);
+
 #endif
 
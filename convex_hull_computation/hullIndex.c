@@ -0,0 +1,544 @@
+/*
+    Implementation details for module which contains a convex hull with a
+    query index. Containment and tangent queries binary search the fan of
+    triangles from the first vertex with exact orientation tests, extreme
+    point queries binary search the edge angles, and the diameter and width
+    are found once by rotating calipers when the index is built.
+*/
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "problem.h"
+#include "convexHull.h"
+#include "hullIndex.h"
+#include "predicates.h"
+
+/* Points whose binary searches advance in lockstep in the batch queries. */
+#define QUERY_BLOCK (256)
+
+/* Builds the index of the hull of the given points, which are sorted in
+   place and freed. */
+struct hullIndex *buildHullIndex(struct doublePoint *points, int numPoints);
+
+/* Finds the diameter and width of the hull by rotating calipers. */
+void measureHull(struct hullIndex *index);
+
+/* Returns a pseudo angle of the direction (dx, dy) in [0, 4), which
+   increases with the angle counterclockwise from the positive x axis in the
+   same way as the angle itself, without computing any trigonometry. */
+double pseudoAngle(double dx, double dy);
+
+/* Finds the first edge whose angle is at least the given angle relative to
+   the first edge, or 0 if there is none. */
+int findEdgeAngle(struct hullIndex *index, double angle);
+
+/* Walks from a vertex to a neighbour farther in the direction (dx, dy)
+   until there is none, fixing any rounding in the edge angle search. */
+int climbExtreme(struct hullIndex *index, int vertex, double dx, double dy);
+
+/* Checks whether the edge from vertex i to the next is visible from the
+   point (x, y), which lies strictly to its right. */
+int edgeVisible(struct hullIndex *index, int i, double x, double y);
+
+/* Finds the first edge visible from the point (x, y) on the way
+   counterclockwise from the hidden edge to the visible edge. */
+int firstVisibleEdge(struct hullIndex *index, int hidden, int visible,
+                     double x, double y);
+
+/* Evaluates the orientation determinant in floating point as orient2d
+   does first, writing the error bound below which its sign is uncertain. */
+double orientationFilter(double ax, double ay, double bx, double by,
+                         double cx, double cy, double *errorBound);
+
+/* Return the hull of the given problem with its query index. */
+struct hullIndex *newHullIndex(struct problem *p) {
+    return buildHullIndex(toDoublePoints(p), p->numPoints);
+}
+
+/* Return the query index of a hull computed by any of the hull algorithms. */
+struct hullIndex *indexHullArray(struct hullArray *hull) {
+    /* Rounding the vertices to doubles could make a vertex collinear with
+     * or inside its neighbours, so the hull is built again from them. */
+    struct doublePoint *points = (struct doublePoint *)malloc(
+        (hull->numPoints + 1) * sizeof(struct doublePoint));
+    assert(points);
+    for (int i = 0; i < hull->numPoints; i++) {
+        points[i].x = (double)hull->pointsX[i];
+        points[i].y = (double)hull->pointsY[i];
+    }
+    return buildHullIndex(points, hull->numPoints);
+}
+
+/* Return 1 if the point (x, y) lies inside or on the boundary of the hull. */
+int hullContains(struct hullIndex *index, double x, double y) {
+    int n = index->numPoints;
+    double *pointsX = index->pointsX;
+    double *pointsY = index->pointsY;
+    if (n == 0) {
+        return 0;
+    }
+    if (n == 1) {
+        return x == pointsX[0] && y == pointsY[0];
+    }
+    if (n == 2) {
+        return orient2d(pointsX[0], pointsY[0], pointsX[1], pointsY[1], x, y) ==
+                   0 &&
+               x >= fmin(pointsX[0], pointsX[1]) &&
+               x <= fmax(pointsX[0], pointsX[1]) &&
+               y >= fmin(pointsY[0], pointsY[1]) &&
+               y <= fmax(pointsY[0], pointsY[1]);
+    }
+
+    /* The point must lie within the angle of the hull at the first vertex. */
+    if (orient2d(pointsX[0], pointsY[0], pointsX[1], pointsY[1], x, y) < 0 ||
+        orient2d(pointsX[0], pointsY[0], pointsX[n - 1], pointsY[n - 1], x,
+                 y) > 0) {
+        return 0;
+    }
+
+    /* Find the triangle of the fan from the first vertex whose angle holds
+     * the point, then check the point against its outer edge. */
+    int low = 1, high = n - 2;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (orient2d(pointsX[0], pointsY[0], pointsX[mid], pointsY[mid], x,
+                     y) >= 0) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return orient2d(pointsX[low], pointsY[low], pointsX[low + 1],
+                    pointsY[low + 1], x, y) >= 0;
+}
+
+/* Return the position of the hull vertex farthest in the direction (dx, dy). */
+int hullExtremePoint(struct hullIndex *index, double dx, double dy) {
+    int n = index->numPoints;
+    if (n == 0) {
+        return -1;
+    }
+    if (n < 3 || (dx == 0 && dy == 0)) {
+        return climbExtreme(index, 0, dx, dy);
+    }
+
+    /* The extreme vertex starts the first edge turned at least a quarter
+     * turn counterclockwise from the direction, which is where the edges
+     * stop moving forward in it. */
+    double angle = pseudoAngle(-dy, dx) - pseudoAngle(index->pointsX[1] -
+                                                          index->pointsX[0],
+                                                      index->pointsY[1] -
+                                                          index->pointsY[0]);
+    if (angle < 0) {
+        angle += 4;
+    }
+    return climbExtreme(index, findEdgeAngle(index, angle), dx, dy);
+}
+
+/* Find the tangents to the hull from the point (x, y). */
+int hullTangents(struct hullIndex *index, double x, double y, int *first,
+                 int *last) {
+    int n = index->numPoints;
+    double *pointsX = index->pointsX;
+    double *pointsY = index->pointsY;
+    if (n == 0 || hullContains(index, x, y)) {
+        return 0;
+    }
+    if (n == 1) {
+        *first = 0;
+        *last = 0;
+        return 1;
+    }
+    if (n == 2) {
+        double turn = orient2d(pointsX[0], pointsY[0], pointsX[1], pointsY[1],
+                               x, y);
+        if (turn == 0) {
+            /* Only the nearer end of the segment is seen. */
+            double toFirst = fabs(x - pointsX[0]) + fabs(y - pointsY[0]);
+            double toSecond = fabs(x - pointsX[1]) + fabs(y - pointsY[1]);
+            *first = toFirst < toSecond ? 0 : 1;
+        } else {
+            *first = turn < 0 ? 0 : 1;
+        }
+        *last = turn == 0 ? *first : 1 - *first;
+        return 1;
+    }
+
+    /* The edges seen from the point form one run around the hull. Find an
+     * edge in it and an edge outside it, so the ends of the run can be
+     * found by binary search between them. */
+    int visible, hidden;
+    int firstSeen = edgeVisible(index, 0, x, y);
+    int lastSeen = edgeVisible(index, n - 1, x, y);
+    if (!firstSeen && !lastSeen) {
+        /* The point is within the angle at the first vertex, so it is
+         * beyond the outer edge of its fan triangle. */
+        int low = 1, high = n - 2;
+        while (low < high) {
+            int mid = (low + high + 1) / 2;
+            if (orient2d(pointsX[0], pointsY[0], pointsX[mid], pointsY[mid], x,
+                         y) >= 0) {
+                low = mid;
+            } else {
+                high = mid - 1;
+            }
+        }
+        visible = low;
+        hidden = 0;
+    } else if (!firstSeen || !lastSeen) {
+        visible = firstSeen ? 0 : n - 1;
+        hidden = firstSeen ? n - 1 : 0;
+    } else {
+        /* The point is behind the first vertex, so the ray from the point
+         * through it leaves the hull through an edge the point cannot see,
+         * which is found by the fan search in the opposite direction. */
+        int low = 1, high = n - 2;
+        while (low < high) {
+            int mid = (low + high + 1) / 2;
+            if (orient2d(pointsX[0], pointsY[0], pointsX[mid], pointsY[mid], x,
+                         y) <= 0) {
+                low = mid;
+            } else {
+                high = mid - 1;
+            }
+        }
+        visible = 0;
+        hidden = low;
+    }
+
+    *first = firstVisibleEdge(index, hidden, visible, x, y);
+    /* Searching the hull in reverse finds the last visible edge, which the
+     * last vertex seen ends. */
+    int lastEdge = visible;
+    int length = (hidden - visible + n) % n;
+    while (length > 1) {
+        int half = length / 2;
+        int mid = (lastEdge + half) % n;
+        if (edgeVisible(index, mid, x, y)) {
+            lastEdge = mid;
+            length -= half;
+        } else {
+            length = half;
+        }
+    }
+    *last = (lastEdge + 1) % n;
+    return 1;
+}
+
+/* Test many points for containment at once. */
+void hullContainsBatch(struct hullIndex *index, double *pointsX,
+                       double *pointsY, int numQueries,
+                       unsigned char *inside) {
+    int n = index->numPoints;
+    double *hullX = index->pointsX;
+    double *hullY = index->pointsY;
+    if (n < 3) {
+        for (int q = 0; q < numQueries; q++) {
+            inside[q] = hullContains(index, pointsX[q], pointsY[q]);
+        }
+        return;
+    }
+
+    int wedge[QUERY_BLOCK];
+    unsigned char uncertain[QUERY_BLOCK];
+    for (int start = 0; start < numQueries; start += QUERY_BLOCK) {
+        int count = numQueries - start < QUERY_BLOCK ? numQueries - start
+                                                     : QUERY_BLOCK;
+        double *x = pointsX + start;
+        double *y = pointsY + start;
+        unsigned char *result = inside + start;
+
+        /* Check each point against the angle at the first vertex. */
+        for (int q = 0; q < count; q++) {
+            double bound1, bound2;
+            double turn1 = orientationFilter(hullX[0], hullY[0], hullX[1],
+                                             hullY[1], x[q], y[q], &bound1);
+            double turn2 =
+                orientationFilter(hullX[0], hullY[0], hullX[n - 1],
+                                  hullY[n - 1], x[q], y[q], &bound2);
+            result[q] = turn1 >= 0 && turn2 <= 0;
+            uncertain[q] = fabs(turn1) < bound1 || fabs(turn2) < bound2;
+            wedge[q] = 1;
+        }
+
+        /* Every search covers the same range, so all the points take the
+         * same number of steps and each step is one pass over the block. */
+        for (int length = n - 2; length > 1;) {
+            int half = length / 2;
+            for (int q = 0; q < count; q++) {
+                int mid = wedge[q] + half;
+                double bound;
+                double turn = orientationFilter(hullX[0], hullY[0], hullX[mid],
+                                                hullY[mid], x[q], y[q], &bound);
+                wedge[q] = turn >= 0 ? mid : wedge[q];
+                uncertain[q] |= fabs(turn) < bound;
+            }
+            length -= half;
+        }
+
+        for (int q = 0; q < count; q++) {
+            int i = wedge[q];
+            double bound;
+            double turn = orientationFilter(hullX[i], hullY[i], hullX[i + 1],
+                                            hullY[i + 1], x[q], y[q], &bound);
+            result[q] &= turn >= 0;
+            uncertain[q] |= fabs(turn) < bound;
+        }
+
+        /* Points within rounding error of a line take the exact path. */
+        for (int q = 0; q < count; q++) {
+            if (uncertain[q]) {
+                result[q] = hullContains(index, x[q], y[q]);
+            }
+        }
+    }
+}
+
+/* Find the extreme hull vertex in many directions at once. */
+void hullExtremePointBatch(struct hullIndex *index, double *directionsX,
+                           double *directionsY, int numQueries,
+                           int *vertices) {
+    int n = index->numPoints;
+    if (n < 3) {
+        for (int q = 0; q < numQueries; q++) {
+            vertices[q] = hullExtremePoint(index, directionsX[q], directionsY[q]);
+        }
+        return;
+    }
+
+    double firstAngle = pseudoAngle(index->pointsX[1] - index->pointsX[0],
+                                    index->pointsY[1] - index->pointsY[0]);
+    double *edgeAngles = index->edgeAngles;
+    double angles[QUERY_BLOCK];
+    for (int start = 0; start < numQueries; start += QUERY_BLOCK) {
+        int count = numQueries - start < QUERY_BLOCK ? numQueries - start
+                                                     : QUERY_BLOCK;
+        double *dx = directionsX + start;
+        double *dy = directionsY + start;
+        int *result = vertices + start;
+
+        for (int q = 0; q < count; q++) {
+            double angle = pseudoAngle(-dy[q], dx[q]) - firstAngle;
+            angles[q] = angle < 0 ? angle + 4 : angle;
+            result[q] = 0;
+        }
+
+        /* Find the first edge whose angle is at least each target, as
+         * findEdgeAngle does, in lockstep. */
+        for (int length = n; length > 1;) {
+            int half = length / 2;
+            for (int q = 0; q < count; q++) {
+                int mid = result[q] + half;
+                result[q] = edgeAngles[mid] < angles[q] ? mid : result[q];
+            }
+            length -= half;
+        }
+
+        for (int q = 0; q < count; q++) {
+            int edge = edgeAngles[result[q]] < angles[q] ? result[q] + 1
+                                                          : result[q];
+            if (dx[q] == 0 && dy[q] == 0) {
+                edge = 0;
+            }
+            result[q] = climbExtreme(index, edge % n, dx[q], dy[q]);
+        }
+    }
+}
+
+/* Free the index and its hull. */
+void freeHullIndex(struct hullIndex *index) {
+    if (index) {
+        free(index->pointsX);
+        free(index->pointsY);
+        free(index->edgeAngles);
+        free(index);
+    }
+}
+
+struct hullIndex *buildHullIndex(struct doublePoint *points, int numPoints) {
+    struct hullIndex *index = (struct hullIndex *)malloc(sizeof(struct hullIndex));
+    assert(index);
+    struct doublePoint *hull = (struct doublePoint *)malloc(
+        (numPoints + 1) * sizeof(struct doublePoint));
+    assert(hull);
+    int n = monotoneChainDouble(points, numPoints, HULL_ORDER_COUNTERCLOCKWISE,
+                                hull, NULL);
+    /* Fewer than 3 points have no hull, as with the other algorithms. */
+    free(points);
+
+    index->numPoints = n;
+    index->pointsX = (double *)malloc((n + 1) * sizeof(double));
+    assert(index->pointsX);
+    index->pointsY = (double *)malloc((n + 1) * sizeof(double));
+    assert(index->pointsY);
+    index->edgeAngles = (double *)malloc((n + 1) * sizeof(double));
+    assert(index->edgeAngles);
+    for (int i = 0; i < n; i++) {
+        index->pointsX[i] = hull[i].x;
+        index->pointsY[i] = hull[i].y;
+    }
+    free(hull);
+
+    /* Measure every edge angle from the first edge, so the angles increase
+     * all the way around the hull. */
+    if (n > 0) {
+        index->pointsX[n] = index->pointsX[0];
+        index->pointsY[n] = index->pointsY[0];
+    }
+    double firstAngle = 0;
+    for (int i = 0; i < n; i++) {
+        double angle = pseudoAngle(index->pointsX[i + 1] - index->pointsX[i],
+                                   index->pointsY[i + 1] - index->pointsY[i]);
+        if (i == 0) {
+            firstAngle = angle;
+        }
+        angle -= firstAngle;
+        index->edgeAngles[i] = angle < 0 ? angle + 4 : angle;
+    }
+
+    measureHull(index);
+    return index;
+}
+
+void measureHull(struct hullIndex *index) {
+    int n = index->numPoints;
+    double *pointsX = index->pointsX;
+    double *pointsY = index->pointsY;
+    index->diameter = 0;
+    index->diameterFirst = 0;
+    index->diameterSecond = 0;
+    index->width = 0;
+    index->widthEdge = 0;
+    index->widthVertex = 0;
+    if (n == 2) {
+        index->diameter = hypot(pointsX[1] - pointsX[0], pointsY[1] - pointsY[0]);
+        index->diameterSecond = 1;
+    }
+    if (n < 3) {
+        return;
+    }
+
+    /* Turn a pair of parallel lines around the hull, one along each edge in
+     * turn and the other through the vertex farthest from it, which only
+     * ever moves forward. Every pair of vertices the lines pass through
+     * is a candidate for the diameter. The farthest vertex starts the first
+     * edge turned at least half a turn from the edge, which is decided on
+     * the edge angles, since cross products of nearly parallel edges can
+     * get the wrong sign on thin hulls. */
+    double diameterSquared = -1;
+    index->width = INFINITY;
+    int far = 1;
+    for (int i = 0; i < n; i++) {
+        double edgeX = pointsX[i + 1] - pointsX[i];
+        double edgeY = pointsY[i + 1] - pointsY[i];
+        for (int steps = 0; steps < n; steps++) {
+            double turn = index->edgeAngles[far] - index->edgeAngles[i];
+            if ((turn < 0 ? turn + 4 : turn) >= 2) {
+                break;
+            }
+            far = (far + 1) % n;
+        }
+
+        double distance = (edgeX * (pointsY[far] - pointsY[i]) -
+                           edgeY * (pointsX[far] - pointsX[i])) /
+                          hypot(edgeX, edgeY);
+        if (distance < index->width) {
+            index->width = distance;
+            index->widthEdge = i;
+            index->widthVertex = far;
+        }
+        for (int end = i; end <= i + 1; end++) {
+            double dx = pointsX[far] - pointsX[end];
+            double dy = pointsY[far] - pointsY[end];
+            if (dx * dx + dy * dy > diameterSquared) {
+                diameterSquared = dx * dx + dy * dy;
+                index->diameterFirst = end % n;
+                index->diameterSecond = far;
+            }
+        }
+    }
+    index->diameter = sqrt(diameterSquared);
+}
+
+double pseudoAngle(double dx, double dy) {
+    double sum = fabs(dx) + fabs(dy);
+    if (sum == 0) {
+        return 0;
+    }
+    /* The ratio runs from -1 to 1 across each half turn, so the left half
+     * is folded to run from 1 to 3 and the lower right quarter moved to
+     * run from 3 to 4. */
+    double ratio = dy / sum;
+    if (dx < 0) {
+        return 2 - ratio;
+    }
+    return dy < 0 ? 4 + ratio : ratio;
+}
+
+int findEdgeAngle(struct hullIndex *index, double angle) {
+    int low = 0, high = index->numPoints;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (index->edgeAngles[mid] < angle) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low % index->numPoints;
+}
+
+int climbExtreme(struct hullIndex *index, int vertex, double dx, double dy) {
+    int n = index->numPoints;
+    double *pointsX = index->pointsX;
+    double *pointsY = index->pointsY;
+    for (int steps = 0; steps < n; steps++) {
+        int next = (vertex + 1) % n;
+        int prev = (vertex + n - 1) % n;
+        double here = pointsX[vertex] * dx + pointsY[vertex] * dy;
+        if (pointsX[next] * dx + pointsY[next] * dy > here) {
+            vertex = next;
+        } else if (pointsX[prev] * dx + pointsY[prev] * dy > here) {
+            vertex = prev;
+        } else {
+            break;
+        }
+    }
+    return vertex;
+}
+
+int edgeVisible(struct hullIndex *index, int i, double x, double y) {
+    int next = (i + 1) % index->numPoints;
+    return orient2d(index->pointsX[i], index->pointsY[i], index->pointsX[next],
+                    index->pointsY[next], x, y) < 0;
+}
+
+int firstVisibleEdge(struct hullIndex *index, int hidden, int visible,
+                     double x, double y) {
+    int n = index->numPoints;
+    /* Counterclockwise from the hidden edge the edges stay hidden up to
+     * the first visible one, so bisect the run between the two. */
+    int length = (visible - hidden + n) % n;
+    while (length > 1) {
+        int half = length / 2;
+        int mid = (hidden + half) % n;
+        if (edgeVisible(index, mid, x, y)) {
+            length = half;
+        } else {
+            hidden = mid;
+            length -= half;
+        }
+    }
+    return (hidden + 1) % n;
+}
+
+double orientationFilter(double ax, double ay, double bx, double by,
+                         double cx, double cy, double *errorBound) {
+    double detLeft = (ax - cx) * (by - cy);
+    double detRight = (ay - cy) * (bx - cx);
+    *errorBound = ORIENT_ERROR_BOUND * (fabs(detLeft) + fabs(detRight));
+    return detLeft - detRight;
+}
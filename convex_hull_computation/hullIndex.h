@@ -0,0 +1,80 @@
+/*
+    Header for module which contains a convex hull stored as an array
+    backed polygon, with an index answering containment, extreme point
+    and tangent queries in O(log h) time, where h is the number of hull
+    points.
+*/
+
+#ifndef HULLINDEX_H
+#define HULLINDEX_H
+
+struct problem;
+struct hullArray;
+
+struct hullIndex {
+    /* Hull vertices in double precision, counterclockwise from the
+        leftmost point, with no three collinear. */
+    int numPoints;
+    double *pointsX;
+    double *pointsY;
+    /* Direction of the edge from each vertex to the next as a pseudo
+        angle in [0, 4], measured counterclockwise from the first edge
+        in quarter turns, so the values are in increasing order. */
+    double *edgeAngles;
+    /* Greatest distance between two hull vertices, and the vertices. */
+    double diameter;
+    int diameterFirst;
+    int diameterSecond;
+    /* Least distance between two parallel lines enclosing the hull, one
+        of which runs along the edge from widthEdge to the next vertex and
+        the other through widthVertex. */
+    double width;
+    int widthEdge;
+    int widthVertex;
+};
+
+/* Return the hull of the given problem with its query index. Each
+    coordinate is rounded to the nearest double. */
+struct hullIndex *newHullIndex(struct problem *p);
+
+/* Return the query index of a hull computed by any of the hull
+    algorithms, whose vertices may be in any HULL_ORDER. */
+struct hullIndex *indexHullArray(struct hullArray *hull);
+
+/* Return 1 if the point (x, y) lies inside or on the boundary of the
+    hull, and 0 otherwise. The result is exact. */
+int hullContains(struct hullIndex *index, double x, double y);
+
+/* Return the position of the hull vertex farthest in the direction
+    (dx, dy), or -1 if the hull is empty. Of two vertices on an edge
+    perpendicular to the direction, either may be returned. */
+int hullExtremePoint(struct hullIndex *index, double dx, double dy);
+
+/* Find the tangents to the hull from the point (x, y). If the point is
+    outside the hull, the positions of the first and last hull vertices
+    seen from it, counterclockwise, are written to first and last and 1
+    is returned. Otherwise 0 is returned. The result is exact. */
+int hullTangents(struct hullIndex *index, double x, double y, int *first,
+                 int *last);
+
+/* Test numQueries points for containment at once, writing 1 to inside
+    for each point inside or on the boundary of the hull and 0 for every
+    other point. The binary searches of a block of points advance in
+    lockstep with floating point orientation tests, so the compiler can
+    vectorize them, and only points too close to an edge for the result
+    to be certain are tested again exactly. */
+void hullContainsBatch(struct hullIndex *index, double *pointsX,
+                       double *pointsY, int numQueries,
+                       unsigned char *inside);
+
+/* Find the extreme hull vertex in each of numQueries directions at once,
+    writing their positions to vertices. The binary searches advance in
+    lockstep as in hullContainsBatch. */
+void hullExtremePointBatch(struct hullIndex *index, double *directionsX,
+                           double *directionsY, int numQueries,
+                           int *vertices);
+
+/* Free the index and its hull. */
+void freeHullIndex(struct hullIndex *index);
+
+#endif
@@ -0,0 +1,404 @@
+/*
+    Implementation details for module which contains an incremental convex
+    hull. The hull is kept as its upper and lower chains, each a treap of
+    points keyed by x, so a point is located, inserted and its neighbours
+    removed in O(log h) expected time. Every point is removed at most once
+    after it is inserted, so insertion takes amortized O(log h) time.
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "problem.h"
+#include "convexHull.h"
+#include "incrementalHull.h"
+#include "linkedList.h"
+
+struct chainNode {
+    long double x;
+    long double y;
+    /* Random heap priority, which keeps the treap balanced. */
+    unsigned int priority;
+    struct chainNode *left;
+    struct chainNode *right;
+};
+
+/* One chain of the hull, ordered by x. The lower chain is stored as the upper
+   chain of the points mirrored in the x axis, so both share the same code. */
+struct hullChain {
+    struct chainNode *root;
+    int size;
+    /* 1 for the upper chain and -1 for the lower chain. */
+    int sign;
+};
+
+struct incrementalHull {
+    struct hullChain upper;
+    struct hullChain lower;
+    /* State of the xorshift generator for treap priorities. */
+    unsigned long long seed;
+};
+
+/* Inserts a point into a chain if it lies strictly above it, removing the
+   chain points which are no longer on the hull. Returns 1 if the point was
+   inserted. */
+int insertChainPoint(struct hullChain *chain, long double x, long double y,
+                     unsigned int priority);
+
+/* Finds the chain point with the greatest x less than the given x. */
+struct chainNode *findBelow(struct chainNode *node, long double x);
+
+/* Finds the chain point with the least x greater than the given x. */
+struct chainNode *findAbove(struct chainNode *node, long double x);
+
+/* Finds the chain point with the given x. */
+struct chainNode *findEqual(struct chainNode *node, long double x);
+
+/* Inserts a node into the treap below the given root and returns the new
+   root. */
+struct chainNode *insertNode(struct chainNode *root, struct chainNode *node);
+
+/* Removes and frees the node with the given x from the treap below the given
+   root, and returns the new root. */
+struct chainNode *removeNode(struct chainNode *root, long double x);
+
+/* Joins two treaps where every x in the first is less than every x in the
+   second, and returns the new root. */
+struct chainNode *joinNodes(struct chainNode *left, struct chainNode *right);
+
+/* Computes the cross product of b - a and c - a, which is positive if c is
+   left of the line from a to b. */
+long double crossProduct(long double aX, long double aY, long double bX,
+                         long double bY, long double cX, long double cY);
+
+/* Finds the chain point with the least x. */
+struct chainNode *firstNode(struct chainNode *node);
+
+/* Finds the chain point with the greatest x. */
+struct chainNode *lastNode(struct chainNode *node);
+
+/* Writes the points of a treap in order of x, restoring the sign of y, and
+   returns the number of points written so far. */
+int writeChain(struct chainNode *node, int sign, long double *pointsX,
+               long double *pointsY, int count);
+
+/* Frees every node of a treap. */
+void freeChain(struct chainNode *node);
+
+/* Return a new empty incremental hull. */
+struct incrementalHull *newIncrementalHull() {
+    struct incrementalHull *hull =
+        (struct incrementalHull *)malloc(sizeof(struct incrementalHull));
+    assert(hull);
+    hull->upper.root = NULL;
+    hull->upper.size = 0;
+    hull->upper.sign = 1;
+    hull->lower.root = NULL;
+    hull->lower.size = 0;
+    hull->lower.sign = -1;
+    hull->seed = 88172645463325252ULL;
+    return hull;
+}
+
+/* Insert the point (x, y) into the hull. */
+int insertHullPoint(struct incrementalHull *hull, long double x,
+                    long double y) {
+    /* Draw a treap priority from a xorshift generator. */
+    hull->seed ^= hull->seed << 13;
+    hull->seed ^= hull->seed >> 7;
+    hull->seed ^= hull->seed << 17;
+    unsigned int priority = (unsigned int)(hull->seed >> 32);
+
+    int changed = insertChainPoint(&(hull->upper), x, y, priority);
+    changed |= insertChainPoint(&(hull->lower), x, -y, priority);
+    return changed;
+}
+
+/* Insert every point of the given problem into the hull. */
+int insertProblemPoints(struct incrementalHull *hull, struct problem *p) {
+    int changed = 0;
+    for (int i = 0; i < p->numPoints; i++) {
+        changed += insertHullPoint(hull, p->pointsX[i], p->pointsY[i]);
+    }
+    return changed;
+}
+
+/* Return the number of points on the current hull. */
+int incrementalHullSize(struct incrementalHull *hull) {
+    int size = hull->upper.size + hull->lower.size;
+    if (size == 0) {
+        return 0;
+    }
+
+    /* Both chains run between the least and greatest x, and share their
+     * endpoints unless the hull has a vertical edge at that end. A hull of
+     * a single point only shares it once. */
+    if (-firstNode(hull->lower.root)->y == firstNode(hull->upper.root)->y) {
+        size--;
+    }
+    if (-lastNode(hull->lower.root)->y == lastNode(hull->upper.root)->y &&
+        hull->upper.size > 1) {
+        size--;
+    }
+    return size;
+}
+
+/* Return a new list holding the current hull in the given order. */
+struct linkedList *snapshotIncrementalHull(struct incrementalHull *hull,
+                                           int order) {
+    struct linkedList *list = newList();
+    int numLower = hull->lower.size;
+    int numUpper = hull->upper.size;
+    if (numLower == 0) {
+        return list;
+    }
+
+    /* Read both chains from left to right, the lower one straight into the
+     * start of the ring. */
+    int capacity = numLower + numUpper;
+    long double *pointsX = (long double *)malloc(capacity * sizeof(long double));
+    assert(pointsX);
+    long double *pointsY = (long double *)malloc(capacity * sizeof(long double));
+    assert(pointsY);
+    long double *upperX = (long double *)malloc(numUpper * sizeof(long double));
+    assert(upperX);
+    long double *upperY = (long double *)malloc(numUpper * sizeof(long double));
+    assert(upperY);
+    writeChain(hull->lower.root, -1, pointsX, pointsY, 0);
+    writeChain(hull->upper.root, 1, upperX, upperY, 0);
+
+    /* Run counterclockwise from the leftmost point: along the lower chain,
+     * then back along the upper chain, skipping endpoints the chains share. */
+    int numHull = numLower;
+    for (int i = numUpper - 1; i >= 0; i--) {
+        if (i == numUpper - 1 && upperX[i] == pointsX[numLower - 1] &&
+            upperY[i] == pointsY[numLower - 1]) {
+            continue;
+        }
+        if (i == 0 && upperX[0] == pointsX[0] && upperY[0] == pointsY[0]) {
+            continue;
+        }
+        pointsX[numHull] = upperX[i];
+        pointsY[numHull] = upperY[i];
+        numHull++;
+    }
+    free(upperX);
+    free(upperY);
+
+    /* The other orders walk the ring backwards, starting from the leftmost
+     * point for Jarvis' March or from the lowest point for Graham's Scan. */
+    int start = 0;
+    int step = 1;
+    if (order == HULL_ORDER_JARVIS || order == HULL_ORDER_GRAHAM) {
+        step = numHull - 1;
+    }
+    if (order == HULL_ORDER_GRAHAM) {
+        for (int i = 1; i < numHull; i++) {
+            if (pointsY[i] < pointsY[start] ||
+                (pointsY[i] == pointsY[start] && pointsX[i] < pointsX[start])) {
+                start = i;
+            }
+        }
+    }
+    for (int i = 0, current = start; i < numHull; i++) {
+        insertTail(list, pointsX[current], pointsY[current]);
+        current = (current + step) % numHull;
+    }
+
+    free(pointsX);
+    free(pointsY);
+    return list;
+}
+
+/* Free the hull and all its points. */
+void freeIncrementalHull(struct incrementalHull *hull) {
+    freeChain(hull->upper.root);
+    freeChain(hull->lower.root);
+    free(hull);
+}
+
+int insertChainPoint(struct hullChain *chain, long double x, long double y,
+                     unsigned int priority) {
+    /* A point directly below a chain point is not on this chain, and a point
+     * directly above one replaces it. */
+    struct chainNode *equal = findEqual(chain->root, x);
+    if (equal) {
+        if (y <= equal->y) {
+            return 0;
+        }
+        chain->root = removeNode(chain->root, x);
+        chain->size--;
+    }
+
+    /* A point on or below the chain segment spanning its x is not on the
+     * chain either. */
+    struct chainNode *below = findBelow(chain->root, x);
+    struct chainNode *above = findAbove(chain->root, x);
+    if (below && above &&
+        crossProduct(below->x, below->y, above->x, above->y, x, y) <= 0) {
+        return 0;
+    }
+
+    /* Remove the points on each side which are no longer strictly above the
+     * segment from their outer neighbour to the new point. */
+    while (below) {
+        struct chainNode *outer = findBelow(chain->root, below->x);
+        if (outer == NULL ||
+            crossProduct(outer->x, outer->y, x, y, below->x, below->y) > 0) {
+            break;
+        }
+        chain->root = removeNode(chain->root, below->x);
+        chain->size--;
+        below = outer;
+    }
+    while (above) {
+        struct chainNode *outer = findAbove(chain->root, above->x);
+        if (outer == NULL ||
+            crossProduct(x, y, outer->x, outer->y, above->x, above->y) > 0) {
+            break;
+        }
+        chain->root = removeNode(chain->root, above->x);
+        chain->size--;
+        above = outer;
+    }
+
+    struct chainNode *node = (struct chainNode *)malloc(sizeof(struct chainNode));
+    assert(node);
+    node->x = x;
+    node->y = y;
+    node->priority = priority;
+    node->left = NULL;
+    node->right = NULL;
+    chain->root = insertNode(chain->root, node);
+    chain->size++;
+    return 1;
+}
+
+struct chainNode *findBelow(struct chainNode *node, long double x) {
+    struct chainNode *best = NULL;
+    while (node) {
+        if (node->x < x) {
+            best = node;
+            node = node->right;
+        } else {
+            node = node->left;
+        }
+    }
+    return best;
+}
+
+struct chainNode *findAbove(struct chainNode *node, long double x) {
+    struct chainNode *best = NULL;
+    while (node) {
+        if (node->x > x) {
+            best = node;
+            node = node->left;
+        } else {
+            node = node->right;
+        }
+    }
+    return best;
+}
+
+struct chainNode *findEqual(struct chainNode *node, long double x) {
+    while (node && node->x != x) {
+        node = x < node->x ? node->left : node->right;
+    }
+    return node;
+}
+
+struct chainNode *insertNode(struct chainNode *root, struct chainNode *node) {
+    if (root == NULL) {
+        return node;
+    }
+    if (node->x < root->x) {
+        root->left = insertNode(root->left, node);
+        /* Rotate right if the new child outranks its parent. */
+        if (root->left->priority > root->priority) {
+            struct chainNode *child = root->left;
+            root->left = child->right;
+            child->right = root;
+            return child;
+        }
+    } else {
+        root->right = insertNode(root->right, node);
+        /* Rotate left if the new child outranks its parent. */
+        if (root->right->priority > root->priority) {
+            struct chainNode *child = root->right;
+            root->right = child->left;
+            child->left = root;
+            return child;
+        }
+    }
+    return root;
+}
+
+struct chainNode *removeNode(struct chainNode *root, long double x) {
+    if (root == NULL) {
+        return NULL;
+    }
+    if (x < root->x) {
+        root->left = removeNode(root->left, x);
+    } else if (x > root->x) {
+        root->right = removeNode(root->right, x);
+    } else {
+        struct chainNode *joined = joinNodes(root->left, root->right);
+        free(root);
+        return joined;
+    }
+    return root;
+}
+
+struct chainNode *joinNodes(struct chainNode *left, struct chainNode *right) {
+    if (left == NULL) {
+        return right;
+    }
+    if (right == NULL) {
+        return left;
+    }
+    if (left->priority > right->priority) {
+        left->right = joinNodes(left->right, right);
+        return left;
+    }
+    right->left = joinNodes(left, right->left);
+    return right;
+}
+
+long double crossProduct(long double aX, long double aY, long double bX,
+                         long double bY, long double cX, long double cY) {
+    return (bX - aX) * (cY - aY) - (bY - aY) * (cX - aX);
+}
+
+struct chainNode *firstNode(struct chainNode *node) {
+    while (node->left) {
+        node = node->left;
+    }
+    return node;
+}
+
+struct chainNode *lastNode(struct chainNode *node) {
+    while (node->right) {
+        node = node->right;
+    }
+    return node;
+}
+
+int writeChain(struct chainNode *node, int sign, long double *pointsX,
+               long double *pointsY, int count) {
+    if (node == NULL) {
+        return count;
+    }
+    count = writeChain(node->left, sign, pointsX, pointsY, count);
+    pointsX[count] = node->x;
+    pointsY[count] = sign * node->y;
+    count++;
+    return writeChain(node->right, sign, pointsX, pointsY, count);
+}
+
+void freeChain(struct chainNode *node) {
+    if (node) {
+        freeChain(node->left);
+        freeChain(node->right);
+        free(node);
+    }
+}
@@ -0,0 +1,42 @@
+/*
+    Header for module which contains an incremental convex hull, which
+    takes points one at a time and can report the current hull at any
+    point.
+*/
+
+#ifndef INCREMENTALHULL_H
+#define INCREMENTALHULL_H
+
+#include "linkedList.h"
+
+struct incrementalHull;
+
+struct problem;
+
+/* Return a new empty incremental hull. */
+struct incrementalHull *newIncrementalHull();
+
+/* Insert the point (x, y) into the hull in amortized O(log h) time, where
+    h is the number of hull points. Returns 1 if the hull changed, or 0 if
+    the point lies inside or on the boundary of the current hull. */
+int insertHullPoint(struct incrementalHull *hull, long double x,
+                    long double y);
+
+/* Insert every point of the given problem into the hull. Returns the
+    number of points which changed the hull. */
+int insertProblemPoints(struct incrementalHull *hull, struct problem *p);
+
+/* Return the number of points on the current hull. */
+int incrementalHullSize(struct incrementalHull *hull);
+
+/* Return a new list holding the current hull in the given HULL_ORDER, in
+    O(h) time. With HULL_ORDER_JARVIS or HULL_ORDER_GRAHAM,
+    traverseRingForward prints the list as jarvisMarch or grahamScan
+    would for the same points. Collinear boundary points are dropped. */
+struct linkedList *snapshotIncrementalHull(struct incrementalHull *hull,
+                                           int order);
+
+/* Free the hull and all its points. */
+void freeIncrementalHull(struct incrementalHull *hull);
+
+#endif
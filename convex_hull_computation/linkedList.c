@@ -124,6 +124,20 @@ void insertTail(struct linkedList *list, long double x, long double y) {
     list->tail = node;
 }
 
+/* Return the number of items in the given list. */
+int listLength(struct linkedList *list) {
+    assert(list != NULL);
+    int length = 0;
+    struct linkedListNode *node = list->head;
+
+    while (node) {
+        length++;
+        node = node->next;
+    }
+
+    return length;
+}
+
 /* Free all items in the given list. */
 void freeList(struct linkedList *list) {
     assert(list != NULL);
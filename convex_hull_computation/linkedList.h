@@ -32,6 +32,9 @@ void insertHead(struct linkedList *list, long double x, long double y);
 /* Insert the given x, y pair at the tail of the list */
 void insertTail(struct linkedList *list, long double x, long double y);
 
+/* Return the number of items in the given list. */
+int listLength(struct linkedList *list);
+
 /* Free all items in the given list. */
 void freeList(struct linkedList *list);
 
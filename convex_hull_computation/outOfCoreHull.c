@@ -0,0 +1,196 @@
+/*
+    Implementation details for module which contains an out-of-core convex
+    hull. Every hull point of a set of points is a hull point of any subset
+    containing it, so the hull of the points read so far is a complete
+    summary of them: each chunk is merged with that running hull by the
+    double precision monotone chain, and memory stays O(chunk + h).
+*/
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "convexHull.h"
+#include "outOfCoreHull.h"
+
+/* Points converted between writes to the binary file. */
+#define CONVERT_BUFFER_POINTS (1 << 12)
+
+/* Convert a text point file to a binary point file. */
+long long convertPointFile(char *textPath, char *binaryPath) {
+    FILE *in = fopen(textPath, "r");
+    if (in == NULL) {
+        return -1;
+    }
+    long long numPoints;
+    if (fscanf(in, "%lld", &numPoints) != 1 || numPoints < 0) {
+        fclose(in);
+        return -1;
+    }
+    FILE *out = fopen(binaryPath, "wb");
+    if (out == NULL) {
+        fclose(in);
+        return -1;
+    }
+
+    struct pointFileHeader header;
+    memcpy(header.magic, POINT_FILE_MAGIC, sizeof(header.magic));
+    header.numPoints = numPoints;
+    int ok = fwrite(&header, sizeof(header), 1, out) == 1;
+
+    /* Scanning straight into doubles rounds each coordinate once, and the
+     * points go through a fixed buffer so neither file is held in memory. */
+    struct doublePoint buffer[CONVERT_BUFFER_POINTS];
+    long long written = 0;
+    while (ok && written < numPoints) {
+        int count = 0;
+        while (count < CONVERT_BUFFER_POINTS && written + count < numPoints &&
+               fscanf(in, "%lf %lf", &buffer[count].x, &buffer[count].y) == 2) {
+            count++;
+        }
+        if (count == 0) {
+            /* The file holds fewer points than its first line claims. */
+            ok = 0;
+            break;
+        }
+        ok = fwrite(buffer, sizeof(struct doublePoint), count, out) ==
+             (size_t)count;
+        written += count;
+    }
+
+    fclose(in);
+    if (fclose(out) != 0) {
+        ok = 0;
+    }
+    if (!ok) {
+        remove(binaryPath);
+        return -1;
+    }
+    return written;
+}
+
+/* Construct the convex hull of the points in a binary point file. */
+struct hullArray *outOfCoreHull(char *path, int chunkPoints, int order) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct pointFileHeader)) {
+        close(fd);
+        return NULL;
+    }
+    size_t length = st.st_size;
+    char *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    /* Check the header before trusting its point count. */
+    struct pointFileHeader *header = (struct pointFileHeader *)map;
+    long long numPoints = header->numPoints;
+    if (memcmp(header->magic, POINT_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        numPoints < 0 ||
+        (size_t)numPoints > (length - sizeof(struct pointFileHeader)) /
+                                sizeof(struct doublePoint)) {
+        munmap(map, length);
+        return NULL;
+    }
+    madvise(map, length, MADV_SEQUENTIAL);
+    struct doublePoint *points =
+        (struct doublePoint *)(map + sizeof(struct pointFileHeader));
+
+    if (chunkPoints <= 0) {
+        chunkPoints = DEFAULT_CHUNK_POINTS;
+    }
+    if (numPoints < chunkPoints) {
+        chunkPoints = (int)numPoints;
+    }
+
+    /* The running hull and the current chunk are copied together into the
+     * work array, whose room for two extra points is used for padding, and
+     * the merged hull is written back to the hull array. Both only grow
+     * past the chunk size as far as the hull does. */
+    int capacity = chunkPoints + 2;
+    struct doublePoint *work =
+        (struct doublePoint *)malloc(capacity * sizeof(struct doublePoint));
+    assert(work);
+    struct doublePoint *hull =
+        (struct doublePoint *)malloc((capacity + 1) * sizeof(struct doublePoint));
+    assert(hull);
+
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t released = 0;
+    long long comparisons = 0;
+    int numHull = 0;
+    for (long long start = 0; start < numPoints; start += chunkPoints) {
+        int count = numPoints - start < chunkPoints ? (int)(numPoints - start)
+                                                     : chunkPoints;
+        if (numHull + count + 2 > capacity) {
+            capacity = numHull + count + 2;
+            work = (struct doublePoint *)realloc(
+                work, capacity * sizeof(struct doublePoint));
+            assert(work);
+            hull = (struct doublePoint *)realloc(
+                hull, (capacity + 1) * sizeof(struct doublePoint));
+            assert(hull);
+        }
+        memcpy(work, hull, numHull * sizeof(struct doublePoint));
+        memcpy(work + numHull, points + start, count * sizeof(struct doublePoint));
+
+        /* The chunk has been copied, so drop its pages from memory. The
+         * mapping is read only, so they are reread from the file if needed. */
+        size_t end = sizeof(struct pointFileHeader) +
+                     (start + count) * sizeof(struct doublePoint);
+        size_t releaseEnd = end / pageSize * pageSize;
+        if (releaseEnd > released) {
+            madvise(map + released, releaseEnd - released, MADV_DONTNEED);
+            released = releaseEnd;
+        }
+
+        /* The monotone chain needs at least 3 points, so pad degenerate
+         * rounds with copies of the first point, which leave the hull
+         * unchanged. */
+        int n = numHull + count;
+        while (n < 3) {
+            work[n++] = work[0];
+        }
+
+        long long operationCount = 0;
+        numHull = monotoneChainDouble(work, n, order, hull, &operationCount);
+        comparisons += operationCount;
+    }
+    munmap(map, length);
+    free(work);
+
+    /* Like monotoneChain, fewer than 3 points have no hull. */
+    if (numPoints < 3) {
+        numHull = 0;
+    }
+
+    struct hullArray *result = (struct hullArray *)malloc(sizeof(struct hullArray));
+    assert(result);
+    result->numPoints = numHull;
+    result->operationCount = comparisons;
+    result->pointsX = NULL;
+    result->pointsY = NULL;
+    if (numHull > 0) {
+        result->pointsX = (long double *)malloc(numHull * sizeof(long double));
+        assert(result->pointsX);
+        result->pointsY = (long double *)malloc(numHull * sizeof(long double));
+        assert(result->pointsY);
+    }
+    for (int i = 0; i < numHull; i++) {
+        result->pointsX[i] = hull[i].x;
+        result->pointsY[i] = hull[i].y;
+    }
+    free(hull);
+
+    return result;
+}
@@ -0,0 +1,42 @@
+/*
+    Header for module which contains an out-of-core convex hull, which
+    reads its points from a memory-mapped binary point file in chunks,
+    and the converter from the text input format to that binary format.
+*/
+
+#ifndef OUTOFCOREHULL_H
+#define OUTOFCOREHULL_H
+
+struct hullArray;
+
+/* Magic bytes at the start of a binary point file. */
+#define POINT_FILE_MAGIC "HULLPTS1"
+
+/* Header of a binary point file. It is followed by numPoints pairs of
+    native endian doubles, laid out as struct doublePoint. */
+struct pointFileHeader {
+    char magic[8];
+    long long numPoints;
+};
+
+/* Points read from the mapping per chunk when no chunk size is given. */
+#define DEFAULT_CHUNK_POINTS (1 << 16)
+
+/* Convert a text point file, holding the number of points followed by
+    one x y pair per line, to a binary point file. Each coordinate is
+    rounded to the nearest double. Returns the number of points written,
+    or -1 if either file cannot be opened or the text file is malformed. */
+long long convertPointFile(char *textPath, char *binaryPath);
+
+/* Construct the convex hull of the points in a binary point file. The
+    file is mapped and read in chunks of chunkPoints points, or
+    DEFAULT_CHUNK_POINTS if chunkPoints is not positive. Only the hull of
+    the points read so far and the current chunk are kept in memory, and
+    the pages of each chunk are released once it has been read. The hull
+    is returned in the given HULL_ORDER with exact orientation tests, as
+    by monotoneChainDouble, and operationCount is the number of point
+    comparisons performed during sorting. Returns NULL if the file cannot
+    be opened or mapped, or is not a binary point file. */
+struct hullArray *outOfCoreHull(char *path, int chunkPoints, int order);
+
+#endif
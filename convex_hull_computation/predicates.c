@@ -0,0 +1,150 @@
+/*
+    Implementation details for module which contains robust geometric
+    predicates on double precision coordinates, following Shewchuk's
+    adaptive precision floating point predicates.
+
+    The exact arithmetic relies on every operation being rounded to double
+    precision, which holds for SSE2 arithmetic on x86-64. It must not be
+    compiled with x87 arithmetic or with multiplies and adds contracted into
+    fused multiply-adds.
+*/
+
+#include <float.h>
+
+#include "predicates.h"
+
+/* The largest relative error of a rounded double operation. */
+#define EPSILON (DBL_EPSILON / 2)
+
+/* Splits a double into two halves of 26 bits each. */
+#define SPLITTER 134217729.0
+
+/* Largest number of components of the exact orientation determinant, the sum
+   of six exact products of two components each. */
+#define MAX_EXPANSION 12
+
+/* Computes a + b as a rounded sum and its exact rounding error. */
+void twoSum(double a, double b, double *sum, double *error);
+
+/* Splits a into a high and a low half which sum to a exactly. */
+void splitDouble(double a, double *high, double *low);
+
+/* Computes a * b as a rounded product and its exact rounding error. */
+void twoProduct(double a, double b, double *product, double *error);
+
+/* Adds b to an expansion of length components, which are nonoverlapping and
+   in increasing order of magnitude, writing the sum to result without zero
+   components. Returns the length of the sum. */
+int growExpansion(int length, double *expansion, double b, double *result);
+
+/* Evaluates the orientation determinant exactly. */
+double orient2dExact(double ax, double ay, double bx, double by, double cx,
+                     double cy);
+
+double orient2d(double ax, double ay, double bx, double by, double cx,
+                double cy) {
+    double detLeft = (ax - cx) * (by - cy);
+    double detRight = (ay - cy) * (bx - cx);
+    double det = detLeft - detRight;
+    double detSum = 0;
+
+    /* If the two products have opposite signs, or one is zero, the
+     * difference cannot change sign through rounding. */
+    if (detLeft > 0) {
+        if (detRight <= 0) {
+            return det;
+        }
+        detSum = detLeft + detRight;
+    } else if (detLeft < 0) {
+        if (detRight >= 0) {
+            return det;
+        }
+        detSum = -detLeft - detRight;
+    } else {
+        return det;
+    }
+
+    /* Trust the sign if the determinant is larger than its error bound. */
+    double errorBound = ORIENT_ERROR_BOUND * detSum;
+    if (det >= errorBound || -det >= errorBound) {
+        return det;
+    }
+
+    return orient2dExact(ax, ay, bx, by, cx, cy);
+}
+
+double orient2dExact(double ax, double ay, double bx, double by, double cx,
+                     double cy) {
+    /* Expand the determinant into six products of the coordinates, each of
+     * which is exact as a rounded product plus its error. */
+    double factors[6][2] = {{ax, by},  {-ax, cy}, {-by, cx},
+                            {-ay, bx}, {ay, cx},  {bx, cy}};
+    double buffers[2][MAX_EXPANSION + 1];
+    double *expansion = buffers[0];
+    double *next = buffers[1];
+    int length = 0;
+
+    for (int i = 0; i < 6; i++) {
+        double product = 0, error = 0;
+        twoProduct(factors[i][0], factors[i][1], &product, &error);
+
+        length = growExpansion(length, expansion, error, next);
+        double *temp = expansion;
+        expansion = next;
+        next = temp;
+
+        length = growExpansion(length, expansion, product, next);
+        temp = expansion;
+        expansion = next;
+        next = temp;
+    }
+
+    /* The largest component holds the sign of the whole expansion. */
+    return expansion[length - 1];
+}
+
+void twoSum(double a, double b, double *sum, double *error) {
+    double x = a + b;
+    double bVirtual = x - a;
+    double aVirtual = x - bVirtual;
+    double bRoundoff = b - bVirtual;
+    double aRoundoff = a - aVirtual;
+    *sum = x;
+    *error = aRoundoff + bRoundoff;
+}
+
+void splitDouble(double a, double *high, double *low) {
+    double c = SPLITTER * a;
+    double aBig = c - a;
+    *high = c - aBig;
+    *low = a - *high;
+}
+
+void twoProduct(double a, double b, double *product, double *error) {
+    double x = a * b;
+    double aHigh = 0, aLow = 0, bHigh = 0, bLow = 0;
+    splitDouble(a, &aHigh, &aLow);
+    splitDouble(b, &bHigh, &bLow);
+    double error1 = x - (aHigh * bHigh);
+    double error2 = error1 - (aLow * bHigh);
+    double error3 = error2 - (aHigh * bLow);
+    *product = x;
+    *error = (aLow * bLow) - error3;
+}
+
+int growExpansion(int length, double *expansion, double b, double *result) {
+    double q = b;
+    int resultLength = 0;
+    for (int i = 0; i < length; i++) {
+        double sum = 0, error = 0;
+        twoSum(q, expansion[i], &sum, &error);
+        q = sum;
+        if (error != 0) {
+            result[resultLength++] = error;
+        }
+    }
+    if (q != 0 || resultLength == 0) {
+        result[resultLength++] = q;
+    }
+    return resultLength;
+}
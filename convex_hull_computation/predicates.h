@@ -0,0 +1,26 @@
+/*
+    Header for module which contains robust geometric predicates
+    on double precision coordinates.
+*/
+
+#ifndef PREDICATES_H
+#define PREDICATES_H
+
+#include <float.h>
+
+/* Relative error bound of the floating point orientation determinant: its
+    sign is certain when it is at least this times the sum of the absolute
+    values of its two products. Callers which filter many determinants at
+    once can use it, passing only the uncertain ones to orient2d. */
+#define ORIENT_ERROR_BOUND \
+    ((3.0 + 8.0 * DBL_EPSILON) * DBL_EPSILON / 2)
+
+/* Return a positive value if the points a, b and c occur in counterclockwise
+    order, a negative value if they occur in clockwise order and zero if
+    they are collinear. The sign is always exact: the determinant is first
+    evaluated in floating point, and only recomputed exactly when it is
+    too close to zero for its sign to be trusted. */
+double orient2d(double ax, double ay, double bx, double by, double cx,
+                double cy);
+
+#endif
@@ -0,0 +1,262 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "problem.h"
+#include "dynamic_time_warping.h"
+#include "dtw_fast.h"
+#include "dtw_parallel.h"
+#include "dtw_wavefront.h"
+
+/* Sequence lengths benchmarked, up to the limit given on the command
+   line. */
+static const int sequenceLengths[] = {1000, 10000, 100000, 1000000};
+#define SEQUENCE_LENGTH_COUNT \
+    (sizeof(sequenceLengths) / sizeof(sequenceLengths[0]))
+
+/* Sequence pairs: independent random walks, one smooth signal sampled
+   under two different random time warps with a little noise, which is
+   what DTW is meant to align, and independent white noise, whose best
+   path has no structure for a coarse resolution to find. */
+#define SERIES_WALK 0
+#define SERIES_WARPED 1
+#define SERIES_NOISE 2
+#define SERIES_COUNT 3
+static const char *seriesNames[] = {"walk", "warped", "noise"};
+
+/* Algorithms benchmarked, in the order they are run. The cost-only DTW
+   runs first, as the exact distance the others are measured against. */
+#define ALGORITHM_COST 0
+#define ALGORITHM_STANDARD 1
+#define ALGORITHM_WAVEFRONT 2
+#define ALGORITHM_TILED 3
+#define ALGORITHM_FAST_1 4
+#define ALGORITHM_FAST_10 5
+#define ALGORITHM_FAST_40 6
+#define ALGORITHM_COUNT 7
+static const char *algorithmNames[] = {"cost",  "standard", "wavefront",
+                                       "tiled", "fast1",    "fast10",
+                                       "fast40"};
+
+/* Radius of each FastDTW run, by algorithm. */
+static const int fastRadii[] = {0, 0, 0, 0, 1, 10, 40};
+
+/* Returns the next value of a xorshift generator, so sequences only depend
+   on the seed and not on the C library. */
+unsigned long long nextRandom(unsigned long long *state);
+
+/* Returns a random value uniformly distributed in [0, 1). */
+long double randomUnit(unsigned long long *state);
+
+/* Fills both sequences of the problem with a pair of the given kind. */
+void generateSequences(struct problem *p, int series,
+                       unsigned long long *state);
+
+/* Samples a sum of sines at length points of a random monotone time warp,
+   adding uniform noise. */
+void warpedSignal(long double *sequence, int length,
+                  unsigned long long *state);
+
+/* Runs an algorithm on the problem and returns the distance it finds. */
+long double runAlgorithm(int algorithm, struct problem *p);
+
+/* Frees a solution from newSolution, whose matrix rows are allocated one
+   by one. */
+void freeSolution(struct problem *p, struct solution *s);
+
+/* Returns the elapsed time between two timestamps in milliseconds. */
+double elapsedMs(struct timespec *start, struct timespec *end);
+
+int main(int argc, char **argv) {
+    unsigned long long seed = 1;
+    int maxLength = 10000;
+    /* dynamicTimeWarping allocates the whole (n + 1) x (m + 1) matrix, so
+       it is skipped once the matrix has more cells than this. */
+    long long matrixBudget = 25000000LL;
+    /* With -csv, each result is printed as a comma separated line starting
+       with the time of the run, so the output can be appended to a file to
+       track the results over time. */
+    int csv = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-max") == 0 && i + 1 < argc) {
+            maxLength = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-matrix") == 0 && i + 1 < argc) {
+            matrixBudget = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "-csv") == 0) {
+            csv = 1;
+        } else {
+            fprintf(stderr,
+                    "usage: %s [-seed n] [-max length] [-matrix cells] "
+                    "[-csv]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    long long runTime = (long long)time(NULL);
+    if (!csv) {
+        printf("%8s %7s %10s %11s %16s %10s\n", "length", "series",
+               "algorithm", "ms", "distance", "error %");
+    }
+
+    for (int series = 0; series < SERIES_COUNT; series++) {
+        for (int i = 0; i < (int)SEQUENCE_LENGTH_COUNT; i++) {
+            if (sequenceLengths[i] > maxLength) {
+                break;
+            }
+            struct problem p;
+            p.seqALength = sequenceLengths[i];
+            p.seqBLength = sequenceLengths[i];
+            p.sequenceA =
+                (long double *)malloc(p.seqALength * sizeof(long double));
+            assert(p.sequenceA);
+            p.sequenceB =
+                (long double *)malloc(p.seqBLength * sizeof(long double));
+            assert(p.sequenceB);
+            p.windowSize = 0;
+            p.maximumPathLength = 0;
+            unsigned long long state = seed ? seed : 1;
+            generateSequences(&p, series, &state);
+
+            long double exact = 0;
+            for (int a = 0; a < ALGORITHM_COUNT; a++) {
+                long long cells =
+                    (long long)(p.seqALength + 1) * (p.seqBLength + 1);
+                if (a == ALGORITHM_STANDARD && cells > matrixBudget) {
+                    if (!csv) {
+                        printf("%8d %7s %10s %11s %16s %10s\n",
+                               sequenceLengths[i], seriesNames[series],
+                               algorithmNames[a], "-", "-", "-");
+                    }
+                    continue;
+                }
+
+                struct timespec begin, end;
+                clock_gettime(CLOCK_MONOTONIC, &begin);
+                long double distance = runAlgorithm(a, &p);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                if (a == ALGORITHM_COST) {
+                    exact = distance;
+                }
+                /* The error is relative to the exact distance, and never
+                   negative for FastDTW, whose path is a real one. */
+                double error =
+                    exact > 0 ? (double)((distance - exact) / exact) * 100
+                              : 0;
+
+                double ms = elapsedMs(&begin, &end);
+                if (csv) {
+                    printf("%lld,%llu,%d,%s,%s,%.3f,%.6Lf,%.6f\n", runTime,
+                           seed, sequenceLengths[i], seriesNames[series],
+                           algorithmNames[a], ms, distance, error);
+                } else {
+                    printf("%8d %7s %10s %11.3f %16.6Lf %10.4f\n",
+                           sequenceLengths[i], seriesNames[series],
+                           algorithmNames[a], ms, distance, error);
+                }
+                fflush(stdout);
+            }
+
+            free(p.sequenceA);
+            free(p.sequenceB);
+        }
+    }
+    if (!csv) {
+        printf("(times in ms; error is relative to the exact distance of "
+               "cost, which dynamicTimeWarping matches; fastN is FastDTW with "
+               "radius N)\n");
+    }
+    return 0;
+}
+
+unsigned long long nextRandom(unsigned long long *state) {
+    unsigned long long x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+long double randomUnit(unsigned long long *state) {
+    return (nextRandom(state) >> 11) * (1.0L / 9007199254740992.0L);
+}
+
+void generateSequences(struct problem *p, int series,
+                       unsigned long long *state) {
+    if (series == SERIES_WARPED) {
+        warpedSignal(p->sequenceA, p->seqALength, state);
+        warpedSignal(p->sequenceB, p->seqBLength, state);
+        return;
+    }
+    long double walkA = 0;
+    long double walkB = 0;
+    for (int i = 0; i < p->seqALength; i++) {
+        long double a = randomUnit(state) * 2 - 1;
+        long double b = randomUnit(state) * 2 - 1;
+        if (series == SERIES_WALK) {
+            walkA += a;
+            walkB += b;
+            a = walkA;
+            b = walkB;
+        }
+        p->sequenceA[i] = a;
+        if (i < p->seqBLength) {
+            p->sequenceB[i] = b;
+        }
+    }
+}
+
+void warpedSignal(long double *sequence, int length,
+                  unsigned long long *state) {
+    /* The signal spans 20 periods of its slowest sine whatever the length,
+       and the warp speeds it up and slows it down four times over, by up
+       to half. The phases of the warp are drawn anew for each sequence,
+       but the signal itself is the same. */
+    long double pi = 3.14159265358979323846L;
+    long double phase = randomUnit(state) * 2 * pi;
+    long double amount = 0.5L * randomUnit(state);
+    for (int i = 0; i < length; i++) {
+        long double x = (long double)i / length;
+        long double t = x + amount * sinl(4 * 2 * pi * x + phase) /
+                                (4 * 2 * pi);
+        long double value = sinl(20 * 2 * pi * t) +
+                            0.5L * sinl(47 * 2 * pi * t) +
+                            0.25L * sinl(113 * 2 * pi * t);
+        sequence[i] = value + 0.1L * (randomUnit(state) * 2 - 1);
+    }
+}
+
+long double runAlgorithm(int algorithm, struct problem *p) {
+    if (algorithm == ALGORITHM_STANDARD) {
+        struct solution *s = dynamicTimeWarping(p);
+        long double distance = s->optimalValue;
+        freeSolution(p, s);
+        return distance;
+    } else if (algorithm == ALGORITHM_WAVEFRONT) {
+        return dynamicTimeWarpingWavefront(p);
+    } else if (algorithm == ALGORITHM_TILED) {
+        return dynamicTimeWarpingParallel(p, 0);
+    } else if (algorithm >= ALGORITHM_FAST_1) {
+        return fastDynamicTimeWarping(p, fastRadii[algorithm]);
+    }
+    return dynamicTimeWarpingCost(p);
+}
+
+void freeSolution(struct problem *p, struct solution *s) {
+    for (int i = 0; i <= p->seqALength; i++) {
+        free(s->matrix[i]);
+    }
+    free(s->matrix);
+    free(s);
+}
+
+double elapsedMs(struct timespec *start, struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e3 +
+           (end->tv_nsec - start->tv_nsec) / 1e6;
+}
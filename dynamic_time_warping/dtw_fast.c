@@ -0,0 +1,342 @@
+/*
+    Implementation details for module which contains an approximate DTW in
+    the style of FastDTW. Resolution 0 is the given sequences, and each
+    resolution above it averages pairs of samples of the one below, until
+    either sequence is no longer than radius + 2 samples. That resolution
+    is solved over its whole matrix, and every resolution below it over
+    the window its warping path projects to.
+*/
+
+#include <assert.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "dtw_fast.h"
+#include "dynamic_time_warping.h"
+
+#define LDINFINITY (LDBL_MAX / 2.0L)
+
+/* The cells of one resolution inside its window, stored row by row. Unlike
+   a warpingBand, whose rows all take the width of the widest, row i starts
+   at cells + rowStart[i], so a path with long horizontal runs does not
+   widen every row. */
+struct projectedWindow {
+    int rows;
+    int columns;
+    /* Row i holds the cells (i, j) for firstColumn[i] <= j <=
+       lastColumn[i]. Row 0 holds only the first cell (0, 0). */
+    int *firstColumn;
+    int *lastColumn;
+    size_t *rowStart;
+    long double *cells;
+};
+
+/* Returns a sequence of (length + 1) / 2 samples, each the mean of a pair
+   of samples of the given one, the last alone if the length is odd. */
+long double *coarsenSequence(long double *sequence, int length);
+
+/* Allocates a window over the given row ranges, which it takes ownership
+   of. */
+struct projectedWindow *newProjectedWindow(int rows, int columns,
+                                           int *firstColumn, int *lastColumn);
+
+/* Returns the cost of cell (i, j) of a computed window, or infinity if the
+   cell is outside it. */
+long double projectedWindowCell(struct projectedWindow *window, int i, int j);
+
+/* Computes the costs of the cells of the window and returns the cost of the
+   last cell. */
+long double fillProjectedWindow(struct projectedWindow *window,
+                                long double *sequenceA,
+                                long double *sequenceB);
+
+/* Traces the cheapest path back from the last cell of a computed window,
+   storing its cells from (1, 1) to (rows, columns) in pathRows and
+   pathColumns, which need room for rows + columns - 1 cells. Returns the
+   number of cells on the path. */
+int tracePath(struct projectedWindow *window, int *pathRows,
+              int *pathColumns);
+
+/* Creates the window of the resolution below a path: the two by two block
+   of cells under each cell of the path, widened by radius cells on every
+   side. */
+struct projectedWindow *projectPath(int *pathRows, int *pathColumns,
+                                    int pathLength, int rows, int columns,
+                                    int radius);
+
+/* Frees a window and its cells. */
+void freeProjectedWindow(struct projectedWindow *window);
+
+long double fastDynamicTimeWarping(struct problem *p, int radius) {
+    return fastWarpingDistance(p->sequenceA, p->seqALength, p->sequenceB,
+                               p->seqBLength, radius);
+}
+
+long double fastWarpingDistance(long double *sequenceA, int seqALength,
+                                long double *sequenceB, int seqBLength,
+                                int radius) {
+    if (seqALength == 0 || seqBLength == 0) {
+        return seqALength == seqBLength ? 0 : LDINFINITY;
+    }
+    if (radius < 0) {
+        radius = 0;
+    }
+
+    /* Each resolution halves both lengths, so an int's worth of them is
+     * always enough. */
+    int maximumLevels = (int)(sizeof(int) * CHAR_BIT) + 1;
+    long double **sequencesA =
+        (long double **)malloc(maximumLevels * sizeof(long double *));
+    assert(sequencesA);
+    long double **sequencesB =
+        (long double **)malloc(maximumLevels * sizeof(long double *));
+    assert(sequencesB);
+    int *lengthsA = (int *)malloc(maximumLevels * sizeof(int));
+    assert(lengthsA);
+    int *lengthsB = (int *)malloc(maximumLevels * sizeof(int));
+    assert(lengthsB);
+
+    sequencesA[0] = sequenceA;
+    sequencesB[0] = sequenceB;
+    lengthsA[0] = seqALength;
+    lengthsB[0] = seqBLength;
+    int coarsest = 0;
+    while (lengthsA[coarsest] > radius + 2 && lengthsB[coarsest] > radius + 2) {
+        sequencesA[coarsest + 1] =
+            coarsenSequence(sequencesA[coarsest], lengthsA[coarsest]);
+        sequencesB[coarsest + 1] =
+            coarsenSequence(sequencesB[coarsest], lengthsB[coarsest]);
+        lengthsA[coarsest + 1] = (lengthsA[coarsest] + 1) / 2;
+        lengthsB[coarsest + 1] = (lengthsB[coarsest] + 1) / 2;
+        coarsest++;
+    }
+
+    /* The coarsest resolution is solved over its whole matrix. */
+    int rows = lengthsA[coarsest];
+    int columns = lengthsB[coarsest];
+    int *firstColumn = (int *)malloc((rows + 1) * sizeof(int));
+    assert(firstColumn);
+    int *lastColumn = (int *)malloc((rows + 1) * sizeof(int));
+    assert(lastColumn);
+    for (int i = 1; i <= rows; i++) {
+        firstColumn[i] = 1;
+        lastColumn[i] = columns;
+    }
+    struct projectedWindow *window =
+        newProjectedWindow(rows, columns, firstColumn, lastColumn);
+
+    int *pathRows = NULL;
+    int *pathColumns = NULL;
+    if (coarsest > 0) {
+        /* The longest path is that of the second finest resolution. */
+        pathRows = (int *)malloc((lengthsA[1] + lengthsB[1]) * sizeof(int));
+        assert(pathRows);
+        pathColumns = (int *)malloc((lengthsA[1] + lengthsB[1]) * sizeof(int));
+        assert(pathColumns);
+    }
+
+    long double distance = LDINFINITY;
+    for (int level = coarsest; level >= 0; level--) {
+        distance =
+            fillProjectedWindow(window, sequencesA[level], sequencesB[level]);
+        if (level == 0) {
+            break;
+        }
+        int pathLength = tracePath(window, pathRows, pathColumns);
+        freeProjectedWindow(window);
+        window = projectPath(pathRows, pathColumns, pathLength,
+                             lengthsA[level - 1], lengthsB[level - 1], radius);
+        free(sequencesA[level]);
+        free(sequencesB[level]);
+    }
+
+    freeProjectedWindow(window);
+    free(pathRows);
+    free(pathColumns);
+    free(sequencesA);
+    free(sequencesB);
+    free(lengthsA);
+    free(lengthsB);
+    return distance;
+}
+
+long double *coarsenSequence(long double *sequence, int length) {
+    int coarseLength = (length + 1) / 2;
+    long double *coarse =
+        (long double *)malloc(coarseLength * sizeof(long double));
+    assert(coarse);
+    for (int i = 0; i < length / 2; i++) {
+        coarse[i] = (sequence[2 * i] + sequence[2 * i + 1]) / 2;
+    }
+    if (length % 2 == 1) {
+        coarse[coarseLength - 1] = sequence[length - 1];
+    }
+    return coarse;
+}
+
+struct projectedWindow *newProjectedWindow(int rows, int columns,
+                                           int *firstColumn, int *lastColumn) {
+    struct projectedWindow *window =
+        (struct projectedWindow *)malloc(sizeof(struct projectedWindow));
+    assert(window);
+    window->rows = rows;
+    window->columns = columns;
+    window->firstColumn = firstColumn;
+    window->lastColumn = lastColumn;
+    window->rowStart = (size_t *)malloc((rows + 1) * sizeof(size_t));
+    assert(window->rowStart);
+
+    firstColumn[0] = 0;
+    lastColumn[0] = 0;
+    size_t size = 0;
+    for (int i = 0; i <= rows; i++) {
+        window->rowStart[i] = size;
+        size += lastColumn[i] - firstColumn[i] + 1;
+    }
+    window->cells = (long double *)malloc(size * sizeof(long double));
+    assert(window->cells);
+
+    return window;
+}
+
+long double projectedWindowCell(struct projectedWindow *window, int i,
+                                int j) {
+    if (j < window->firstColumn[i] || j > window->lastColumn[i]) {
+        return LDINFINITY;
+    }
+    return window->cells[window->rowStart[i] + (j - window->firstColumn[i])];
+}
+
+long double fillProjectedWindow(struct projectedWindow *window,
+                                long double *sequenceA,
+                                long double *sequenceB) {
+    window->cells[0] = 0;
+    for (int i = 1; i <= window->rows; i++) {
+        long double *row = window->cells + window->rowStart[i];
+        int first = window->firstColumn[i];
+        /* The cell left of the first one is outside the window. */
+        long double previous = LDINFINITY;
+        for (int j = first; j <= window->lastColumn[i]; j++) {
+            long double cost = fabsl(sequenceA[i - 1] - sequenceB[j - 1]);
+            long double best = projectedWindowCell(window, i - 1, j);
+            long double match = projectedWindowCell(window, i - 1, j - 1);
+            if (previous < best) {
+                best = previous;
+            }
+            if (match < best) {
+                best = match;
+            }
+            previous = cost + best;
+            row[j - first] = previous;
+        }
+    }
+    return projectedWindowCell(window, window->rows, window->columns);
+}
+
+int tracePath(struct projectedWindow *window, int *pathRows,
+              int *pathColumns) {
+    int i = window->rows;
+    int j = window->columns;
+    int length = 0;
+    while (1) {
+        pathRows[length] = i;
+        pathColumns[length] = j;
+        length++;
+        if (i == 1 && j == 1) {
+            break;
+        }
+        /* The match is preferred on ties, and the first row and column
+         * can only be left along their own edge. */
+        long double match = i > 1 && j > 1
+                                ? projectedWindowCell(window, i - 1, j - 1)
+                                : LDINFINITY;
+        long double up =
+            i > 1 ? projectedWindowCell(window, i - 1, j) : LDINFINITY;
+        long double left =
+            j > 1 ? projectedWindowCell(window, i, j - 1) : LDINFINITY;
+        if (match <= up && match <= left) {
+            i--;
+            j--;
+        } else if (up <= left) {
+            i--;
+        } else {
+            j--;
+        }
+    }
+
+    for (int k = 0; k < length / 2; k++) {
+        int row = pathRows[k];
+        pathRows[k] = pathRows[length - 1 - k];
+        pathRows[length - 1 - k] = row;
+        int column = pathColumns[k];
+        pathColumns[k] = pathColumns[length - 1 - k];
+        pathColumns[length - 1 - k] = column;
+    }
+    return length;
+}
+
+/*
+    Cell (I, J) of the coarser resolution covers rows 2I - 1 and 2I and
+    columns 2J - 1 and 2J of the finer one, clipped to its lengths. The
+    path is monotone, so the first and last columns of the projected rows
+    never decrease, and widening by radius cells on every side takes the
+    first column radius rows above and the last column radius rows below.
+*/
+struct projectedWindow *projectPath(int *pathRows, int *pathColumns,
+                                    int pathLength, int rows, int columns,
+                                    int radius) {
+    int *firstColumn = (int *)malloc((rows + 1) * sizeof(int));
+    assert(firstColumn);
+    int *lastColumn = (int *)malloc((rows + 1) * sizeof(int));
+    assert(lastColumn);
+    int *projectedFirst = (int *)malloc((rows + 1) * sizeof(int));
+    assert(projectedFirst);
+    int *projectedLast = (int *)malloc((rows + 1) * sizeof(int));
+    assert(projectedLast);
+    for (int i = 1; i <= rows; i++) {
+        projectedFirst[i] = columns + 1;
+        projectedLast[i] = 0;
+    }
+
+    for (int k = 0; k < pathLength; k++) {
+        int first = 2 * pathColumns[k] - 1;
+        int last = 2 * pathColumns[k] < columns ? 2 * pathColumns[k] : columns;
+        for (int i = 2 * pathRows[k] - 1; i <= 2 * pathRows[k] && i <= rows;
+             i++) {
+            if (first < projectedFirst[i]) {
+                projectedFirst[i] = first;
+            }
+            if (last > projectedLast[i]) {
+                projectedLast[i] = last;
+            }
+        }
+    }
+
+    for (int i = 1; i <= rows; i++) {
+        int above = i - radius > 1 ? i - radius : 1;
+        int below = i + radius < rows ? i + radius : rows;
+        firstColumn[i] = projectedFirst[above] - radius > 1
+                             ? projectedFirst[above] - radius
+                             : 1;
+        lastColumn[i] = projectedLast[below] + radius < columns
+                            ? projectedLast[below] + radius
+                            : columns;
+    }
+
+    free(projectedFirst);
+    free(projectedLast);
+    return newProjectedWindow(rows, columns, firstColumn, lastColumn);
+}
+
+void freeProjectedWindow(struct projectedWindow *window) {
+    if (!window) {
+        return;
+    }
+    free(window->firstColumn);
+    free(window->lastColumn);
+    free(window->rowStart);
+    free(window->cells);
+    free(window);
+}
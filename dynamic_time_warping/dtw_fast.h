@@ -0,0 +1,28 @@
+/*
+    Header for module which contains an approximate DTW in the style of
+    FastDTW. Both sequences are halved repeatedly, the warping path is
+    found at the coarsest resolution, and each finer resolution is only
+    computed in a window around the path projected up from the one below
+    it, so time and memory are linear in the sequence lengths.
+*/
+
+#ifndef DTW_FAST_H
+#define DTW_FAST_H
+
+struct problem;
+
+/* Approximate the DTW distance of the given problem. The window at each
+    resolution holds the projected path widened by radius cells on every
+    side, so a larger radius is slower but closer to the exact distance.
+    The result is the cost of a real warping path, so it is never below
+    the distance of dynamicTimeWarping, and equals it when the sequences
+    are short enough that no coarsening is done. */
+long double fastDynamicTimeWarping(struct problem *p, int radius);
+
+/* Approximate the DTW distance between two sequences, as
+    fastDynamicTimeWarping does, without a problem. */
+long double fastWarpingDistance(long double *sequenceA, int seqALength,
+                                long double *sequenceB, int seqBLength,
+                                int radius);
+
+#endif
@@ -0,0 +1,401 @@
+/*
+    Implementation details for module which contains batch DTW distance
+    matrices. The pairs of a batch are numbered, and threads take blocks
+    of consecutive pairs from a shared counter until none are left, so a
+    thread given long sequences does not hold the others up. Each thread
+    sizes three anti-diagonals for the longest sequence and sweeps every
+    pair it takes through them with the vectorised kernel of
+    dtw_wavefront. A distance file is filled one chunk of pairs at a time,
+    and its header only counts a chunk once the chunk has been synced, so
+    an interrupted run loses at most the chunk it was computing.
+*/
+
+#include <assert.h>
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "dtw_pairwise.h"
+#include "dtw_wavefront.h"
+#include "dynamic_time_warping.h"
+
+#define DINFINITY (DBL_MAX / 2.0)
+
+/* Pairs a thread takes from the counter at once. */
+#define PAIR_BLOCK (64)
+
+/* Pairs of sequences, or a query against sequences, computed together. */
+struct pairwiseBatch {
+    double **sequences;
+    int *lengths;
+    int numSequences;
+    /* The query of a one-to-many batch, or NULL for pairs of sequences. */
+    double *query;
+    int queryLength;
+    int windowSize;
+    /* Pair firstPair + k is written to distances[k], for k below
+       numPairs. In a one-to-many batch, pair i is sequence i. */
+    long long firstPair;
+    long long numPairs;
+    double *distances;
+    /* The next block of pairs to be taken, shared by the threads. */
+    long long nextBlock;
+    /* Length of the longest sequence, which sizes each thread's buffers. */
+    int longest;
+};
+
+/* Computes the pairs of a batch on numThreads threads, or one per online
+   processor if numThreads is not positive. */
+void runPairwiseBatch(struct pairwiseBatch *batch, int numThreads);
+
+/* Takes blocks of pairs of a batch until none are left. */
+void *pairwiseTaskThread(void *arg);
+
+/* Finds the sequences i < j of the pair at position index of pairIndex. */
+void pairAt(long long index, int numSequences, int *i, int *j);
+
+/* Computes the DTW distance between two sequences with the vectorised
+   kernel of dtw_wavefront, in diagonals of at least 3 (min(seqALength,
+   seqBLength) + 2) cells, with the second sequence reversed into reversed,
+   which needs room for max(seqALength, seqBLength) samples. */
+double diagonalDistance(double *sequenceA, int seqALength, double *sequenceB,
+                        int seqBLength, int windowSize, double *diagonals,
+                        double *reversed);
+
+/* Hashes the lengths and samples of a set of sequences with FNV-1a. */
+unsigned long long sequenceFingerprint(double **sequences, int *lengths,
+                                       int numSequences);
+
+/* Writes the header at the start of a distance file and syncs the file.
+   Returns 0 if either fails. */
+int writeDistanceHeader(FILE *file, struct distanceFileHeader *header);
+
+/* Flushes a file and waits until it is on disk. Returns 0 if either
+   fails. */
+int syncFile(FILE *file);
+
+long long pairIndex(int i, int j, int numSequences) {
+    if (i > j) {
+        int swap = i;
+        i = j;
+        j = swap;
+    }
+    return (long long)i * (2LL * numSequences - i - 1) / 2 + (j - i - 1);
+}
+
+void pairwiseDistances(double **sequences, int *lengths, int numSequences,
+                       int windowSize, int numThreads, double *distances) {
+    struct pairwiseBatch batch;
+    batch.sequences = sequences;
+    batch.lengths = lengths;
+    batch.numSequences = numSequences;
+    batch.query = NULL;
+    batch.queryLength = 0;
+    batch.windowSize = windowSize;
+    batch.firstPair = 0;
+    batch.numPairs = (long long)numSequences * (numSequences - 1) / 2;
+    batch.distances = distances;
+    runPairwiseBatch(&batch, numThreads);
+}
+
+void oneToManyDistances(double *query, int queryLength, double **sequences,
+                        int *lengths, int numSequences, int windowSize,
+                        int numThreads, double *distances) {
+    struct pairwiseBatch batch;
+    batch.sequences = sequences;
+    batch.lengths = lengths;
+    batch.numSequences = numSequences;
+    batch.query = query;
+    batch.queryLength = queryLength;
+    batch.windowSize = windowSize;
+    batch.firstPair = 0;
+    batch.numPairs = numSequences;
+    batch.distances = distances;
+    runPairwiseBatch(&batch, numThreads);
+}
+
+long long pairwiseDistancesToFile(double **sequences, int *lengths,
+                                  int numSequences, int windowSize,
+                                  int numThreads, long long chunkPairs,
+                                  char *path) {
+    if (chunkPairs <= 0) {
+        chunkPairs = DEFAULT_CHUNK_PAIRS;
+    }
+    long long totalPairs = (long long)numSequences * (numSequences - 1) / 2;
+    unsigned long long fingerprint =
+        sequenceFingerprint(sequences, lengths, numSequences);
+
+    struct distanceFileHeader header;
+    FILE *file = fopen(path, "r+b");
+    if (file) {
+        if (fread(&header, sizeof(header), 1, file) != 1 ||
+            memcmp(header.magic, DISTANCE_FILE_MAGIC, sizeof(header.magic)) !=
+                0 ||
+            header.numSequences != numSequences ||
+            header.windowSize != windowSize ||
+            header.fingerprint != fingerprint || header.completedPairs < 0 ||
+            header.completedPairs > totalPairs) {
+            fclose(file);
+            return -1;
+        }
+    } else {
+        if (errno != ENOENT) {
+            return -1;
+        }
+        file = fopen(path, "w+b");
+        if (!file) {
+            return -1;
+        }
+        memcpy(header.magic, DISTANCE_FILE_MAGIC, sizeof(header.magic));
+        header.numSequences = numSequences;
+        header.windowSize = windowSize;
+        header.completedPairs = 0;
+        header.fingerprint = fingerprint;
+        if (!writeDistanceHeader(file, &header)) {
+            fclose(file);
+            return -1;
+        }
+    }
+
+    long long remaining = totalPairs - header.completedPairs;
+    double *chunk = (double *)malloc(
+        (remaining < chunkPairs ? remaining + 1 : chunkPairs) *
+        sizeof(double));
+    assert(chunk);
+    int ok = 1;
+    while (ok && header.completedPairs < totalPairs) {
+        long long count = totalPairs - header.completedPairs < chunkPairs
+                              ? totalPairs - header.completedPairs
+                              : chunkPairs;
+        struct pairwiseBatch batch;
+        batch.sequences = sequences;
+        batch.lengths = lengths;
+        batch.numSequences = numSequences;
+        batch.query = NULL;
+        batch.queryLength = 0;
+        batch.windowSize = windowSize;
+        batch.firstPair = header.completedPairs;
+        batch.numPairs = count;
+        batch.distances = chunk;
+        runPairwiseBatch(&batch, numThreads);
+
+        /* The chunk is on disk before the header counts it. */
+        off_t offset = (off_t)sizeof(header) +
+                       (off_t)header.completedPairs * (off_t)sizeof(double);
+        ok = fseeko(file, offset, SEEK_SET) == 0 &&
+             fwrite(chunk, sizeof(double), count, file) == (size_t)count &&
+             syncFile(file);
+        if (ok) {
+            header.completedPairs += count;
+            ok = writeDistanceHeader(file, &header);
+        }
+    }
+
+    free(chunk);
+    if (fclose(file) != 0 || !ok) {
+        return -1;
+    }
+    return totalPairs;
+}
+
+void runPairwiseBatch(struct pairwiseBatch *batch, int numThreads) {
+    batch->nextBlock = 0;
+    batch->longest = batch->queryLength;
+    for (int i = 0; i < batch->numSequences; i++) {
+        if (batch->lengths[i] > batch->longest) {
+            batch->longest = batch->lengths[i];
+        }
+    }
+
+    if (numThreads <= 0) {
+        numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    /* More threads than blocks would find nothing to take. */
+    long long blocks = (batch->numPairs + PAIR_BLOCK - 1) / PAIR_BLOCK;
+    if (numThreads > blocks) {
+        numThreads = (int)blocks;
+    }
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    /* The kernel is chosen on first use, so it is chosen here before the
+     * threads share it. */
+    wavefrontDiagonal(NULL, NULL, NULL, NULL, NULL, 0);
+
+    pthread_t *threads = (pthread_t *)malloc(numThreads * sizeof(pthread_t));
+    assert(threads);
+    /* The first thread's blocks are computed on the calling thread. */
+    for (int t = 1; t < numThreads; t++) {
+        int error =
+            pthread_create(&threads[t], NULL, pairwiseTaskThread, batch);
+        assert(error == 0);
+    }
+    pairwiseTaskThread(batch);
+    for (int t = 1; t < numThreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    free(threads);
+}
+
+void *pairwiseTaskThread(void *arg) {
+    struct pairwiseBatch *batch = (struct pairwiseBatch *)arg;
+    double *diagonals =
+        (double *)malloc(3 * (batch->longest + 2) * sizeof(double));
+    assert(diagonals);
+    double *reversed = (double *)malloc((batch->longest + 1) * sizeof(double));
+    assert(reversed);
+
+    while (1) {
+        long long first =
+            __atomic_fetch_add(&batch->nextBlock, 1, __ATOMIC_RELAXED) *
+            PAIR_BLOCK;
+        if (first >= batch->numPairs) {
+            break;
+        }
+        long long last = first + PAIR_BLOCK < batch->numPairs
+                             ? first + PAIR_BLOCK
+                             : batch->numPairs;
+
+        if (batch->query) {
+            for (long long k = first; k < last; k++) {
+                long long s = batch->firstPair + k;
+                batch->distances[k] = diagonalDistance(
+                    batch->query, batch->queryLength, batch->sequences[s],
+                    batch->lengths[s], batch->windowSize, diagonals,
+                    reversed);
+            }
+            continue;
+        }
+        /* Consecutive pairs run along a row of the triangle and on to the
+         * start of the next. */
+        int i, j;
+        pairAt(batch->firstPair + first, batch->numSequences, &i, &j);
+        for (long long k = first; k < last; k++) {
+            batch->distances[k] = diagonalDistance(
+                batch->sequences[i], batch->lengths[i], batch->sequences[j],
+                batch->lengths[j], batch->windowSize, diagonals, reversed);
+            if (++j == batch->numSequences) {
+                i++;
+                j = i + 1;
+            }
+        }
+    }
+
+    free(diagonals);
+    free(reversed);
+    return NULL;
+}
+
+void pairAt(long long index, int numSequences, int *i, int *j) {
+    /* Row r of the triangle starts at r (2n - r - 1) / 2, and solving for
+     * r gives a first guess, which rounding may leave one row out. */
+    double side = 2.0 * numSequences - 1;
+    long long row = (long long)((side - sqrt(side * side - 8.0 * index)) / 2);
+    if (row < 0) {
+        row = 0;
+    }
+    while (row > 0 && row * (2LL * numSequences - row - 1) / 2 > index) {
+        row--;
+    }
+    while ((row + 1) * (2LL * numSequences - row - 2) / 2 <= index) {
+        row++;
+    }
+    *i = (int)row;
+    *j = (int)(index - row * (2LL * numSequences - row - 1) / 2 + row + 1);
+}
+
+/*
+    Sweeps the anti-diagonals as sweepDiagonals in dtw_wavefront does.
+    With a window, anti-diagonal d only holds the cells i with |2i - d| at
+    most w. Each range of cells starts at most one cell after that of the
+    anti-diagonal before it and ends at most one cell after, so every cell
+    read is either computed or next to a computed range, and the cells
+    just outside each range are set to infinity once it is computed.
+*/
+double diagonalDistance(double *sequenceA, int seqALength, double *sequenceB,
+                        int seqBLength, int windowSize, double *diagonals,
+                        double *reversed) {
+    double *rowSequence = sequenceA;
+    int rows = seqALength;
+    double *columnSequence = sequenceB;
+    int columns = seqBLength;
+    if (seqALength > seqBLength) {
+        rowSequence = sequenceB;
+        rows = seqBLength;
+        columnSequence = sequenceA;
+        columns = seqALength;
+    }
+    if (rows == 0) {
+        return columns == 0 ? 0 : DINFINITY;
+    }
+    if (windowSize == PAIRWISE_NO_WINDOW) {
+        windowSize = columns;
+    }
+    if (windowSize < 0 || columns - rows > windowSize) {
+        return DINFINITY;
+    }
+
+    for (int j = 0; j < columns; j++) {
+        reversed[j] = columnSequence[columns - 1 - j];
+    }
+    double *match = diagonals;
+    double *previous = diagonals + (rows + 2);
+    double *cells = diagonals + 2 * (rows + 2);
+    match[0] = 0;
+    previous[0] = DINFINITY;
+    previous[1] = DINFINITY;
+
+    for (int d = 2; d <= rows + columns; d++) {
+        int low = d - columns > 1 ? d - columns : 1;
+        int high = d - 1 < rows ? d - 1 : rows;
+        /* Half of d - w rounded up and half of d + w rounded down. */
+        if ((d - windowSize + 1) / 2 > low) {
+            low = (d - windowSize + 1) / 2;
+        }
+        if ((d + windowSize) / 2 < high) {
+            high = (d + windowSize) / 2;
+        }
+        wavefrontDiagonal(cells + low, previous + low - 1, match + low - 1,
+                          rowSequence + low - 1, reversed + columns - d + low,
+                          high - low + 1);
+        cells[low - 1] = DINFINITY;
+        cells[high + 1] = DINFINITY;
+
+        double *swap = match;
+        match = previous;
+        previous = cells;
+        cells = swap;
+    }
+    return previous[rows];
+}
+
+unsigned long long sequenceFingerprint(double **sequences, int *lengths,
+                                       int numSequences) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (int i = 0; i < numSequences; i++) {
+        unsigned char *bytes = (unsigned char *)&lengths[i];
+        for (size_t b = 0; b < sizeof(int); b++) {
+            hash = (hash ^ bytes[b]) * 1099511628211ULL;
+        }
+        bytes = (unsigned char *)sequences[i];
+        for (size_t b = 0; b < lengths[i] * sizeof(double); b++) {
+            hash = (hash ^ bytes[b]) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+int writeDistanceHeader(FILE *file, struct distanceFileHeader *header) {
+    return fseeko(file, 0, SEEK_SET) == 0 &&
+           fwrite(header, sizeof(*header), 1, file) == 1 && syncFile(file);
+}
+
+int syncFile(FILE *file) {
+    return fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
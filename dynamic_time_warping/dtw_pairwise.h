@@ -0,0 +1,71 @@
+/*
+    Header for module which contains batch DTW distance matrices, between
+    every pair of a set of sequences or between one query and every
+    sequence of a set. The pairs are shared out between threads, each of
+    which keeps three anti-diagonals of the cost matrix that it reuses for
+    every pair, and DTW is symmetric, so each pair is only computed once.
+*/
+
+#ifndef DTW_PAIRWISE_H
+#define DTW_PAIRWISE_H
+
+/* Window size for no window constraint. */
+#define PAIRWISE_NO_WINDOW (-1)
+
+/* Pairs computed between writes to a distance file when no chunk size is
+    given, 8 MB of distances. */
+#define DEFAULT_CHUNK_PAIRS (1 << 20)
+
+/* Magic bytes at the start of a distance file. */
+#define DISTANCE_FILE_MAGIC "DTWDIST1"
+
+/* Header of a distance file. It is followed by the distances of the
+    numSequences * (numSequences - 1) / 2 pairs as native endian doubles,
+    in the order of pairIndex, of which the first completedPairs have been
+    written. */
+struct distanceFileHeader {
+    char magic[8];
+    long long numSequences;
+    long long windowSize;
+    long long completedPairs;
+    /* Hash of the lengths and samples of the sequences, so a file is only
+        resumed with the set it was started with. */
+    unsigned long long fingerprint;
+};
+
+/* Return the position of the distance between sequences i and j, which
+    must differ, in the upper triangle of a distance matrix stored row by
+    row without its diagonal: (0, 1), (0, 2), ..., (0, n - 1), (1, 2) and
+    so on. */
+long long pairIndex(int i, int j, int numSequences);
+
+/* Compute the DTW distance between every pair of numSequences sequences on
+    numThreads threads, or one per online processor if numThreads is not
+    positive. windowSize limits each path to that many cells either side
+    of the diagonal, as in dynamicTimeWarpingWithWindow, unless it is
+    PAIRWISE_NO_WINDOW. The distances are computed in double precision, as
+    by wavefrontDistance, and written to distances, which needs room for
+    numSequences * (numSequences - 1) / 2 of them, at their pairIndex. */
+void pairwiseDistances(double **sequences, int *lengths, int numSequences,
+                       int windowSize, int numThreads, double *distances);
+
+/* Compute the DTW distance between the query and each of numSequences
+    sequences, as pairwiseDistances does, writing the distance to sequence
+    i to distances[i]. */
+void oneToManyDistances(double *query, int queryLength, double **sequences,
+                        int *lengths, int numSequences, int windowSize,
+                        int numThreads, double *distances);
+
+/* Compute the distances of pairwiseDistances into a distance file, for
+    sets whose matrix does not fit in memory. The pairs are computed in
+    chunks of chunkPairs, or DEFAULT_CHUNK_PAIRS if it is not positive,
+    and the header is updated once each chunk is on disk. If the file
+    already exists, it is resumed from its first missing pair. Returns the
+    number of pairs in the completed file, or -1 if it cannot be opened or
+    written, or was started with other sequences or another window. */
+long long pairwiseDistancesToFile(double **sequences, int *lengths,
+                                  int numSequences, int windowSize,
+                                  int numThreads, long long chunkPairs,
+                                  char *path);
+
+#endif
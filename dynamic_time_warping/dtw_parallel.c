@@ -0,0 +1,368 @@
+/*
+    Implementation details for module which contains a multithreaded DTW.
+    Tile (I, J) needs the last row of the tile above it, the last column
+    of the tile left of it, and the corner cell between them. Each tile
+    column keeps one row of the matrix, preceded by the corner, and each
+    tile row keeps one column. A tile reads and overwrites its own row and
+    column in place, so the tiles of an anti-diagonal never touch the same
+    cells. The threads compute one anti-diagonal of tiles at a time,
+    meeting at a barrier after each, and each tile is itself swept by
+    anti-diagonals of cells with the vectorised kernel of dtw_wavefront.
+*/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "dtw_parallel.h"
+#include "dtw_wavefront.h"
+#include "dynamic_time_warping.h"
+
+#define LDINFINITY (LDBL_MAX / 2.0L)
+#define DINFINITY (DBL_MAX / 2.0)
+
+/* The state of one tiled DTW, shared by its threads. */
+struct tiledSweep {
+    double *sequenceA;
+    /* The second sequence reversed, as the kernel reads it. */
+    double *reversedB;
+    int seqALength;
+    int seqBLength;
+    int windowSize;
+    int tileSize;
+    int tileRows;
+    int tileColumns;
+    /* For tile column J, tileSize + 1 cells from J * (tileSize + 1): the
+       cell left of the column, then its cells, of the last row computed. */
+    double *lastRows;
+    /* For tile row I, tileSize cells from I * tileSize: the cells of its
+       rows in the last column computed. */
+    double *lastColumns;
+    /* The tiles of row I crossing the window are firstTile[I] to
+       lastTile[I]. */
+    int *firstTile;
+    int *lastTile;
+    int numThreads;
+    pthread_barrier_t barrier;
+};
+
+/* One thread of a tiled DTW. */
+struct tiledTask {
+    struct tiledSweep *sweep;
+    int thread;
+};
+
+/* Rounds the sequences of a problem to doubles and finds their distance. */
+long double problemTiledDistance(struct problem *p, int windowSize,
+                                 int numThreads);
+
+/* Computes the tiles of each anti-diagonal assigned to one thread. */
+void *tiledTaskThread(void *arg);
+
+/* Computes the cells of tile (I, J), with room for three anti-diagonals
+   of the tile in diagonals. */
+void computeTile(struct tiledSweep *sweep, int I, int J, double *diagonals);
+
+/* Divides rounding towards negative infinity. */
+int floorHalf(int value);
+
+long double dynamicTimeWarpingParallel(struct problem *p, int numThreads) {
+    return problemTiledDistance(p, TILED_NO_WINDOW, numThreads);
+}
+
+long double dynamicTimeWarpingParallelWithWindow(struct problem *p,
+                                                 int numThreads) {
+    /* A negative window holds no cells, as in
+     * dynamicTimeWarpingWithWindow. */
+    if (p->windowSize < 0) {
+        return p->seqALength == 0 && p->seqBLength == 0 ? 0 : LDINFINITY;
+    }
+    return problemTiledDistance(p, p->windowSize, numThreads);
+}
+
+double tiledDistance(double *sequenceA, int seqALength, double *sequenceB,
+                     int seqBLength, int windowSize, int tileSize,
+                     int numThreads) {
+    if (seqALength == 0 || seqBLength == 0) {
+        return seqALength == seqBLength ? 0 : DINFINITY;
+    }
+    int windowed = windowSize != TILED_NO_WINDOW;
+    if (windowed && abs(seqALength - seqBLength) > windowSize) {
+        return DINFINITY;
+    }
+    if (tileSize <= 0) {
+        tileSize = DEFAULT_TILE_SIZE;
+    }
+
+    struct tiledSweep sweep;
+    sweep.sequenceA = sequenceA;
+    sweep.reversedB = (double *)malloc(seqBLength * sizeof(double));
+    assert(sweep.reversedB);
+    for (int j = 0; j < seqBLength; j++) {
+        sweep.reversedB[j] = sequenceB[seqBLength - 1 - j];
+    }
+    sweep.seqALength = seqALength;
+    sweep.seqBLength = seqBLength;
+    sweep.windowSize = windowSize;
+    sweep.tileSize = tileSize;
+    sweep.tileRows = (seqALength + tileSize - 1) / tileSize;
+    sweep.tileColumns = (seqBLength + tileSize - 1) / tileSize;
+
+    sweep.lastRows = (double *)malloc((size_t)sweep.tileColumns *
+                                      (tileSize + 1) * sizeof(double));
+    assert(sweep.lastRows);
+    sweep.lastColumns = (double *)malloc((size_t)sweep.tileRows * tileSize *
+                                         sizeof(double));
+    assert(sweep.lastColumns);
+    /* Row 0 and column 0 of the matrix are infinite but for cell (0, 0). */
+    for (size_t c = 0; c < (size_t)sweep.tileColumns * (tileSize + 1); c++) {
+        sweep.lastRows[c] = DINFINITY;
+    }
+    sweep.lastRows[0] = 0;
+    for (size_t c = 0; c < (size_t)sweep.tileRows * tileSize; c++) {
+        sweep.lastColumns[c] = DINFINITY;
+    }
+
+    /* Tile (I, J) crosses the window if its top right cell is no more
+     * than windowSize right of the diagonal and its bottom left cell no
+     * more than windowSize left of it. */
+    sweep.firstTile = (int *)malloc(sweep.tileRows * sizeof(int));
+    assert(sweep.firstTile);
+    sweep.lastTile = (int *)malloc(sweep.tileRows * sizeof(int));
+    assert(sweep.lastTile);
+    for (int I = 0; I < sweep.tileRows; I++) {
+        sweep.firstTile[I] = 0;
+        sweep.lastTile[I] = sweep.tileColumns - 1;
+        if (windowed) {
+            long long top = (long long)I * tileSize + 1;
+            long long bottom = top + tileSize - 1 < seqALength
+                                   ? top + tileSize - 1
+                                   : seqALength;
+            long long first = (top - windowSize - 1) / tileSize;
+            long long last = (bottom + windowSize - 1) / tileSize;
+            sweep.firstTile[I] = first > 0 ? (int)first : 0;
+            sweep.lastTile[I] = last < sweep.tileColumns - 1
+                                    ? (int)last
+                                    : sweep.tileColumns - 1;
+        }
+    }
+
+    if (numThreads <= 0) {
+        numThreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    /* More threads than tiles on the longest anti-diagonal would only
+     * wait at the barrier. */
+    int widest = sweep.tileRows < sweep.tileColumns ? sweep.tileRows
+                                                   : sweep.tileColumns;
+    if (numThreads > widest) {
+        numThreads = widest;
+    }
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    sweep.numThreads = numThreads;
+    /* The kernel is chosen on first use, so it is chosen here before the
+     * threads share it. */
+    wavefrontDiagonal(NULL, NULL, NULL, NULL, NULL, 0);
+    int error = pthread_barrier_init(&sweep.barrier, NULL, numThreads);
+    assert(error == 0);
+
+    struct tiledTask *tasks =
+        (struct tiledTask *)malloc(numThreads * sizeof(struct tiledTask));
+    assert(tasks);
+    pthread_t *threads = (pthread_t *)malloc(numThreads * sizeof(pthread_t));
+    assert(threads);
+    /* The first thread's tiles are computed on the calling thread. */
+    for (int t = 0; t < numThreads; t++) {
+        tasks[t].sweep = &sweep;
+        tasks[t].thread = t;
+        if (t > 0) {
+            error = pthread_create(&threads[t], NULL, tiledTaskThread,
+                                   &tasks[t]);
+            assert(error == 0);
+        }
+    }
+    tiledTaskThread(&tasks[0]);
+    for (int t = 1; t < numThreads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    /* The last cell is the end of the last row of the last tile column. */
+    int lastWidth = seqBLength - (sweep.tileColumns - 1) * tileSize;
+    double distance = sweep.lastRows[(size_t)(sweep.tileColumns - 1) *
+                                         (tileSize + 1) +
+                                     lastWidth];
+
+    pthread_barrier_destroy(&sweep.barrier);
+    free(tasks);
+    free(threads);
+    free(sweep.reversedB);
+    free(sweep.lastRows);
+    free(sweep.lastColumns);
+    free(sweep.firstTile);
+    free(sweep.lastTile);
+    return distance;
+}
+
+long double problemTiledDistance(struct problem *p, int windowSize,
+                                 int numThreads) {
+    double *sequenceA = (double *)malloc((p->seqALength + 1) * sizeof(double));
+    assert(sequenceA);
+    double *sequenceB = (double *)malloc((p->seqBLength + 1) * sizeof(double));
+    assert(sequenceB);
+    for (int i = 0; i < p->seqALength; i++) {
+        sequenceA[i] = (double)p->sequenceA[i];
+    }
+    for (int j = 0; j < p->seqBLength; j++) {
+        sequenceB[j] = (double)p->sequenceB[j];
+    }
+
+    double distance =
+        tiledDistance(sequenceA, p->seqALength, sequenceB, p->seqBLength,
+                      windowSize, DEFAULT_TILE_SIZE, numThreads);
+
+    free(sequenceA);
+    free(sequenceB);
+    return distance >= DINFINITY ? LDINFINITY : distance;
+}
+
+void *tiledTaskThread(void *arg) {
+    struct tiledTask *task = (struct tiledTask *)arg;
+    struct tiledSweep *sweep = task->sweep;
+    double *diagonals =
+        (double *)malloc(3 * (sweep->tileSize + 2) * sizeof(double));
+    assert(diagonals);
+
+    for (int D = 0; D < sweep->tileRows + sweep->tileColumns - 1; D++) {
+        int firstRow = D - (sweep->tileColumns - 1) > 0
+                           ? D - (sweep->tileColumns - 1)
+                           : 0;
+        int lastRow = D < sweep->tileRows - 1 ? D : sweep->tileRows - 1;
+        /* The tiles of the anti-diagonal crossing the window are dealt
+         * out to the threads in turn. */
+        int dealt = 0;
+        for (int I = firstRow; I <= lastRow; I++) {
+            int J = D - I;
+            if (J < sweep->firstTile[I] || J > sweep->lastTile[I]) {
+                continue;
+            }
+            if (dealt++ % sweep->numThreads == task->thread) {
+                computeTile(sweep, I, J, diagonals);
+            }
+        }
+        pthread_barrier_wait(&sweep->barrier);
+    }
+
+    free(diagonals);
+    return NULL;
+}
+
+/*
+    Sweeps the anti-diagonals d = i + j of the tile, in the tile's own
+    coordinates, where row 0 is the row above it and column 0 the column
+    left of it, read from top[j] and left[i]. The cells of anti-diagonal d
+    are stored at their row i, and the tile's cells on it are i = max(1, d
+    - width) to min(height, d - 1), with the row above at index 0 and the
+    column left at index d. Within a window, only the cells of the window
+    are computed and the cells either side of them are set to infinity,
+    which are the only ones the next two anti-diagonals read. The tile's
+    last row and last column are written over top and left as they are
+    reached, after the cells of top and left have been read.
+*/
+void computeTile(struct tiledSweep *sweep, int I, int J, double *diagonals) {
+    int tileSize = sweep->tileSize;
+    int r0 = I * tileSize + 1;
+    int c0 = J * tileSize + 1;
+    int height = sweep->seqALength - r0 + 1 < tileSize
+                     ? sweep->seqALength - r0 + 1
+                     : tileSize;
+    int width = sweep->seqBLength - c0 + 1 < tileSize
+                    ? sweep->seqBLength - c0 + 1
+                    : tileSize;
+    int windowed = sweep->windowSize != TILED_NO_WINDOW;
+    /* Row i - c of the matrix is r0 - c0 + 2i - d on anti-diagonal d. */
+    int offset = r0 - c0;
+    double *top = sweep->lastRows + (size_t)J * (tileSize + 1);
+    /* Cell (i, 0) is column[i - 1]. */
+    double *column = sweep->lastColumns + (size_t)I * tileSize;
+    /* Row i aligns sample r0 + i - 2 of the first sequence, and column
+     * j = d - i sample c0 + j - 2 of the second, which is reversed at
+     * seqBLength + 1 - c0 - d + i. */
+    double *sequenceA = sweep->sequenceA + r0 - 1;
+    int reversedStart = sweep->seqBLength + 1 - c0;
+
+    double *match = diagonals;
+    double *previous = diagonals + (tileSize + 2);
+    double *cells = diagonals + 2 * (tileSize + 2);
+    match[0] = top[0];
+    previous[0] = top[1];
+    previous[1] = column[0];
+    if (height == 1) {
+        /* The last row's first cell is the next tile's corner. */
+        top[0] = column[0];
+    }
+
+    for (int d = 2; d <= height + width; d++) {
+        int first = d - width > 1 ? d - width : 1;
+        int last = d - 1 < height ? d - 1 : height;
+        int low = first;
+        int high = last;
+        if (windowed) {
+            int windowLow = -floorHalf(offset - d + sweep->windowSize);
+            int windowHigh = floorHalf(d - offset + sweep->windowSize);
+            low = windowLow > first ? windowLow : first;
+            high = windowHigh < last ? windowHigh : last;
+            if (low - 1 >= first && low - 1 <= last) {
+                cells[low - 1] = DINFINITY;
+            }
+            if (high + 1 <= last && high + 1 >= first) {
+                cells[high + 1] = DINFINITY;
+            }
+        }
+        if (low <= high) {
+            wavefrontDiagonal(cells + low, previous + low - 1, match + low - 1,
+                              sequenceA + low - 1,
+                              sweep->reversedB + reversedStart - d + low,
+                              high - low + 1);
+        }
+
+        /* The row above and the column left of the tile. */
+        if (d <= width) {
+            cells[0] = top[d];
+        }
+        if (d <= height) {
+            cells[d] = column[d - 1];
+            if (d == height) {
+                top[0] = column[d - 1];
+            }
+        }
+
+        /* Cells of the tile's last row and last column, outside the
+         * window if they were not computed. */
+        if (d - height >= 1 && d - height <= width) {
+            top[d - height] =
+                height >= low && height <= high ? cells[height] : DINFINITY;
+        }
+        if (d - width >= 1 && d - width <= height) {
+            column[d - width - 1] = d - width >= low && d - width <= high
+                                  ? cells[d - width]
+                                  : DINFINITY;
+        }
+
+        double *swap = match;
+        match = previous;
+        previous = cells;
+        cells = swap;
+    }
+
+    if (J == sweep->lastTile[I] && J + 1 < sweep->tileColumns) {
+        sweep->lastRows[(size_t)(J + 1) * (tileSize + 1)] = column[height - 1];
+    }
+}
+
+int floorHalf(int value) {
+    return value >= 0 ? value / 2 : -((1 - value) / 2);
+}
@@ -0,0 +1,41 @@
+/*
+    Header for module which contains a multithreaded DTW for very long
+    sequences. The cost matrix is split into square tiles, and the tiles
+    of each anti-diagonal of tiles, which do not depend on each other,
+    are computed concurrently. Tiles only pass their last row and last
+    column on, so memory is linear in the sequence lengths.
+*/
+
+#ifndef DTW_PARALLEL_H
+#define DTW_PARALLEL_H
+
+struct problem;
+
+/* Window size for tiledDistance without a window constraint. */
+#define TILED_NO_WINDOW (-1)
+
+/* Tile side when none is given, whose row, column and samples fit in the
+    first level cache. */
+#define DEFAULT_TILE_SIZE (256)
+
+/* Compute the DTW distance of the given problem on numThreads threads, or
+    one per online processor if numThreads is not positive. The distance
+    is computed in double precision, as by dynamicTimeWarpingWavefront, and
+    matches it exactly. */
+long double dynamicTimeWarpingParallel(struct problem *p, int numThreads);
+
+/* Compute the DTW distance of the given problem within its window, as
+    dynamicTimeWarpingWithWindow does, on numThreads threads. Only the tiles
+    crossing the window are computed. */
+long double dynamicTimeWarpingParallelWithWindow(struct problem *p,
+                                                 int numThreads);
+
+/* Compute the DTW distance between two sequences of doubles with tiles of
+    tileSize cells a side, or DEFAULT_TILE_SIZE if it is not positive, on
+    numThreads threads. windowSize limits the path to that many cells
+    either side of the diagonal, unless it is TILED_NO_WINDOW. */
+double tiledDistance(double *sequenceA, int seqALength, double *sequenceB,
+                     int seqBLength, int windowSize, int tileSize,
+                     int numThreads);
+
+#endif
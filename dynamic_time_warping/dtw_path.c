@@ -0,0 +1,400 @@
+/*
+    Implementation details for module which contains optimal warping path
+    recovery without the whole cost matrix. Without a window, a rectangle of
+    the matrix whose first and last cells are on the path is aligned from
+    the cheapest cost of reaching each cell of its middle row from the first
+    cell, computed forwards, and of reaching the last cell from each cell of
+    the row below, computed backwards. A path leaves the middle row by a
+    step down or down and right, so the cheapest such step splits the
+    rectangle into two smaller ones, each again with both corners on the
+    path. Halving the rows at each level, the levels below the first add up
+    to another pass over the matrix.
+
+    The same split within a window would sweep the whole height of the band
+    at every level, so there the band is computed once, keeping every k-th
+    row for k about sqrt(n), and the path is traced back one block of k rows
+    at a time, recomputing the block from the kept row below it.
+*/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "dtw_path.h"
+#include "dynamic_time_warping.h"
+
+#define LDINFINITY (LDBL_MAX / 2.0L)
+
+/* State shared by the recursion, whose rows of costs are reused by every
+   rectangle, as each is finished with before its halves are aligned. */
+struct pathSearch {
+    long double *sequenceA;
+    long double *sequenceB;
+    /* Indexed by column, so the rows of a rectangle keep their columns. */
+    long double *forward;
+    long double *backward;
+    struct warpingPath *path;
+};
+
+/* The rows of a band kept by the forward pass and the block of rows being
+   traced back through. Row i of the band holds the cells (i, j) for
+   max(1, i - w) <= j <= min(m, i + w), stored width apart from its first
+   cell. */
+struct checkpointedBand {
+    int columns;
+    int windowSize;
+    int width;
+    /* Rows blockRows, 2 blockRows and so on below the last are kept. */
+    int blockRows;
+    long double *kept;
+    /* Rows blockStart + 1 to blockStart + blockRows of the current block. */
+    int blockStart;
+    long double *block;
+};
+
+/* Returns a path of either length 0 with the given distance, or otherwise
+   with room for the given number of cells. */
+struct warpingPath *newWarpingPath(int maximumLength, long double distance);
+
+/* Appends the cells of an optimal path from (firstRow, firstColumn) to
+   (lastRow, lastColumn) to the path. */
+void alignRectangle(struct pathSearch *search, int firstRow, int firstColumn,
+                    int lastRow, int lastColumn);
+
+/* Computes into search->forward the cheapest cost of reaching each cell of
+   row lastRow of a rectangle from its first cell. */
+void forwardCosts(struct pathSearch *search, int firstRow, int firstColumn,
+                  int lastRow, int lastColumn);
+
+/* Computes into search->backward the cheapest cost of reaching the last
+   cell of a rectangle from each cell of row firstRow. */
+void backwardCosts(struct pathSearch *search, int firstRow, int firstColumn,
+                   int lastRow, int lastColumn);
+
+/* Advances row, indexed by column and holding the costs of the row above,
+   to the costs of the cells first to last of a row whose first sample is
+   a. Cells left of lowest are outside the rectangle being computed. */
+void advanceRow(long double *row, long double a, long double *sequenceB,
+                int lowest, int first, int last);
+
+/* Returns the first or last column of row i of a band. */
+int bandFirst(struct checkpointedBand *band, int i);
+int bandLast(struct checkpointedBand *band, int i);
+
+/* Returns the cost of cell (i, j), where row i is kept or in the current
+   block, or row 0, or infinity if the cell is outside the band. */
+long double checkpointedCell(struct checkpointedBand *band, int i, int j);
+
+struct warpingPath *optimalWarpingPath(struct problem *p) {
+    int n = p->seqALength;
+    int m = p->seqBLength;
+    if (n == 0 || m == 0) {
+        return newWarpingPath(0, n == m ? 0 : LDINFINITY);
+    }
+
+    struct pathSearch search;
+    search.sequenceA = p->sequenceA;
+    search.sequenceB = p->sequenceB;
+    search.forward = (long double *)malloc((m + 1) * sizeof(long double));
+    assert(search.forward);
+    search.backward = (long double *)malloc((m + 1) * sizeof(long double));
+    assert(search.backward);
+    search.path = newWarpingPath(n + m - 1, 0);
+
+    alignRectangle(&search, 1, 1, n, m);
+
+    /* Summed from the first cell, as the matrix sums the costs of its
+     * path, so the distance is that of the matrix unless another path is
+     * within rounding of this one. */
+    struct warpingPath *path = search.path;
+    for (int k = 0; k < path->length; k++) {
+        path->distance += fabsl(p->sequenceA[path->rows[k] - 1] -
+                                p->sequenceB[path->columns[k] - 1]);
+    }
+
+    free(search.forward);
+    free(search.backward);
+    return path;
+}
+
+struct warpingPath *optimalWarpingPathWithWindow(struct problem *p) {
+    int n = p->seqALength;
+    int m = p->seqBLength;
+    if (n == 0 || m == 0) {
+        return newWarpingPath(0, n == m ? 0 : LDINFINITY);
+    }
+    if (p->windowSize < 0 || abs(n - m) > p->windowSize) {
+        return newWarpingPath(0, LDINFINITY);
+    }
+
+    struct checkpointedBand band;
+    band.columns = m;
+    band.windowSize = p->windowSize;
+    band.width = p->windowSize < m / 2 ? 2 * p->windowSize + 1 : m;
+    band.blockRows = (int)ceil(sqrt((double)n));
+    /* One more cell than the kept rows take, as there may be none. */
+    int keptRows = (n - 1) / band.blockRows;
+    band.kept = (long double *)malloc(((size_t)keptRows * band.width + 1) *
+                                      sizeof(long double));
+    assert(band.kept);
+    band.block = (long double *)malloc((size_t)band.blockRows * band.width *
+                                       sizeof(long double));
+    assert(band.block);
+    long double *row = (long double *)malloc((m + 1) * sizeof(long double));
+    assert(row);
+
+    row[0] = 0;
+    for (int j = 1; j <= m; j++) {
+        row[j] = LDINFINITY;
+    }
+    for (int i = 1; i <= n; i++) {
+        int first = bandFirst(&band, i);
+        int last = bandLast(&band, i);
+        advanceRow(row, p->sequenceA[i - 1], p->sequenceB, 0, first, last);
+        if (i % band.blockRows == 0 && i < n) {
+            long double *kept =
+                band.kept + (size_t)(i / band.blockRows - 1) * band.width;
+            for (int j = first; j <= last; j++) {
+                kept[j - first] = row[j];
+            }
+        }
+    }
+
+    struct warpingPath *path = newWarpingPath(n + m - 1, row[m]);
+    int i = n;
+    int j = m;
+    int blockEnd = n;
+    while (path->length == 0 || path->rows[path->length - 1] != 1 ||
+           path->columns[path->length - 1] != 1) {
+        /* Recompute the rows of the block from the one kept below it,
+         * which only reach the columns of the band from that row to the
+         * last of the block. */
+        band.blockStart = (blockEnd - 1) / band.blockRows * band.blockRows;
+        for (int column = bandFirst(&band, band.blockStart) - 1;
+             column <= bandLast(&band, blockEnd); column++) {
+            row[column] = checkpointedCell(&band, band.blockStart, column);
+        }
+        for (int r = band.blockStart + 1; r <= blockEnd; r++) {
+            int first = bandFirst(&band, r);
+            int last = bandLast(&band, r);
+            advanceRow(row, p->sequenceA[r - 1], p->sequenceB, 0, first, last);
+            long double *cells =
+                band.block + (size_t)(r - band.blockStart - 1) * band.width;
+            for (int column = first; column <= last; column++) {
+                cells[column - first] = row[column];
+            }
+        }
+
+        while (i > band.blockStart) {
+            path->rows[path->length] = i;
+            path->columns[path->length] = j;
+            path->length++;
+            if (i == 1 && j == 1) {
+                break;
+            }
+            /* The match is preferred on ties, as in tracePath. */
+            long double match = checkpointedCell(&band, i - 1, j - 1);
+            long double up = checkpointedCell(&band, i - 1, j);
+            long double left = checkpointedCell(&band, i, j - 1);
+            if (match <= up && match <= left) {
+                i--;
+                j--;
+            } else if (up <= left) {
+                i--;
+            } else {
+                j--;
+            }
+        }
+        blockEnd = band.blockStart;
+    }
+
+    for (int k = 0; k < path->length / 2; k++) {
+        int r = path->rows[k];
+        path->rows[k] = path->rows[path->length - 1 - k];
+        path->rows[path->length - 1 - k] = r;
+        int column = path->columns[k];
+        path->columns[k] = path->columns[path->length - 1 - k];
+        path->columns[path->length - 1 - k] = column;
+    }
+
+    free(row);
+    free(band.kept);
+    free(band.block);
+    return path;
+}
+
+void freeWarpingPath(struct warpingPath *path) {
+    if (!path) {
+        return;
+    }
+    free(path->rows);
+    free(path->columns);
+    free(path);
+}
+
+struct warpingPath *newWarpingPath(int maximumLength, long double distance) {
+    struct warpingPath *path =
+        (struct warpingPath *)malloc(sizeof(struct warpingPath));
+    assert(path);
+    path->length = 0;
+    path->rows = NULL;
+    path->columns = NULL;
+    path->distance = distance;
+    if (maximumLength > 0) {
+        path->rows = (int *)malloc(maximumLength * sizeof(int));
+        assert(path->rows);
+        path->columns = (int *)malloc(maximumLength * sizeof(int));
+        assert(path->columns);
+    }
+    return path;
+}
+
+/*
+    A rectangle one row or one column high is a single run of cells.
+    Otherwise the step out of the middle row goes from (middle, j) to
+    (middle + 1, j) or (middle + 1, j + 1), and the cheapest of these is the
+    sum of the cost of reaching its first cell and the cost of finishing
+    from its second.
+*/
+void alignRectangle(struct pathSearch *search, int firstRow, int firstColumn,
+                    int lastRow, int lastColumn) {
+    struct warpingPath *path = search->path;
+    if (firstRow == lastRow || firstColumn == lastColumn) {
+        for (int i = firstRow, j = firstColumn;
+             i <= lastRow && j <= lastColumn;) {
+            path->rows[path->length] = i;
+            path->columns[path->length] = j;
+            path->length++;
+            if (firstRow == lastRow) {
+                j++;
+            } else {
+                i++;
+            }
+        }
+        return;
+    }
+
+    int middle = firstRow + (lastRow - firstRow) / 2;
+    forwardCosts(search, firstRow, firstColumn, middle, lastColumn);
+    backwardCosts(search, middle + 1, firstColumn, lastRow, lastColumn);
+
+    long double best = LDINFINITY;
+    int leaveColumn = firstColumn;
+    int enterColumn = firstColumn;
+    for (int j = firstColumn; j <= lastColumn; j++) {
+        long double down = search->forward[j] + search->backward[j];
+        if (down < best) {
+            best = down;
+            leaveColumn = j;
+            enterColumn = j;
+        }
+        if (j < lastColumn) {
+            long double diagonal = search->forward[j] + search->backward[j + 1];
+            if (diagonal < best) {
+                best = diagonal;
+                leaveColumn = j;
+                enterColumn = j + 1;
+            }
+        }
+    }
+
+    alignRectangle(search, firstRow, firstColumn, middle, leaveColumn);
+    alignRectangle(search, middle + 1, enterColumn, lastRow, lastColumn);
+}
+
+void forwardCosts(struct pathSearch *search, int firstRow, int firstColumn,
+                  int lastRow, int lastColumn) {
+    long double *row = search->forward;
+    long double running = 0;
+    for (int j = firstColumn; j <= lastColumn; j++) {
+        running += fabsl(search->sequenceA[firstRow - 1] -
+                         search->sequenceB[j - 1]);
+        row[j] = running;
+    }
+    for (int i = firstRow + 1; i <= lastRow; i++) {
+        advanceRow(row, search->sequenceA[i - 1], search->sequenceB,
+                   firstColumn, firstColumn, lastColumn);
+    }
+}
+
+/*
+    The mirror image of forwardCosts, from the last row of the rectangle up
+    to the first and from the right of each row to the left.
+*/
+void backwardCosts(struct pathSearch *search, int firstRow, int firstColumn,
+                   int lastRow, int lastColumn) {
+    long double *row = search->backward;
+    long double running = 0;
+    for (int j = lastColumn; j >= firstColumn; j--) {
+        running += fabsl(search->sequenceA[lastRow - 1] -
+                         search->sequenceB[j - 1]);
+        row[j] = running;
+    }
+    for (int i = lastRow - 1; i >= firstRow; i--) {
+        long double a = search->sequenceA[i - 1];
+        long double diagonal = LDINFINITY;
+        long double right = LDINFINITY;
+        for (int j = lastColumn; j >= firstColumn; j--) {
+            long double down = row[j];
+            long double minimum = down < right ? down : right;
+            if (diagonal < minimum) {
+                minimum = diagonal;
+            }
+            diagonal = down;
+            right = fabsl(a - search->sequenceB[j - 1]) + minimum;
+            row[j] = right;
+        }
+    }
+}
+
+/*
+    Moving down a row, the columns of a band never move left, so the cell
+    left of the first needs resetting to infinity once its cost has been
+    read as a diagonal, and those right of the last have not been reached
+    yet.
+*/
+void advanceRow(long double *row, long double a, long double *sequenceB,
+                int lowest, int first, int last) {
+    long double diagonal = LDINFINITY;
+    if (first > lowest) {
+        diagonal = row[first - 1];
+        row[first - 1] = LDINFINITY;
+    }
+    long double left = LDINFINITY;
+    for (int j = first; j <= last; j++) {
+        long double up = row[j];
+        long double minimum = up < left ? up : left;
+        if (diagonal < minimum) {
+            minimum = diagonal;
+        }
+        diagonal = up;
+        left = fabsl(a - sequenceB[j - 1]) + minimum;
+        row[j] = left;
+    }
+}
+
+int bandFirst(struct checkpointedBand *band, int i) {
+    return i - band->windowSize > 1 ? i - band->windowSize : 1;
+}
+
+int bandLast(struct checkpointedBand *band, int i) {
+    return i + band->windowSize < band->columns ? i + band->windowSize
+                                                : band->columns;
+}
+
+long double checkpointedCell(struct checkpointedBand *band, int i, int j) {
+    if (i == 0) {
+        return j == 0 ? 0 : LDINFINITY;
+    }
+    int first = bandFirst(band, i);
+    if (j < first || j > bandLast(band, i)) {
+        return LDINFINITY;
+    }
+    if (i > band->blockStart) {
+        return band->block[(size_t)(i - band->blockStart - 1) * band->width +
+                           j - first];
+    }
+    return band->kept[(size_t)(i / band->blockRows - 1) * band->width + j -
+                      first];
+}
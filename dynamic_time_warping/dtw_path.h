@@ -0,0 +1,46 @@
+/*
+    Header for module which contains optimal warping path recovery without
+    keeping the whole cost matrix to trace the path back through. Without a
+    window, the path is found by divide and conquer in the style of
+    Hirschberg: the cell where it crosses the middle row is found from the
+    costs of two rows, and the two halves are solved in turn. Within a
+    window, rows of the band are kept at intervals and the rows between
+    them recomputed as the path is traced back.
+*/
+
+#ifndef DTW_PATH_H
+#define DTW_PATH_H
+
+struct problem;
+
+/* A warping path through the cells of the DTW matrix, indexed as in the
+    matrix of a solution, so cell (i, j) aligns sample i - 1 of the first
+    sequence with sample j - 1 of the second. */
+struct warpingPath {
+    int length;
+    /* Cell k of the path is (rows[k], columns[k]), from (1, 1) to
+        (n, m). */
+    int *rows;
+    int *columns;
+    /* The sum of the costs of the cells of the path. */
+    long double distance;
+};
+
+/* Find an optimal warping path of the given problem, whose distance is
+    that of dynamicTimeWarping, up to rounding between paths of equal
+    cost. Memory is O(n + m) and time about twice that of
+    dynamicTimeWarping. The path is empty, with a distance of 0, if both
+    sequences are, and with an infinite distance if only one is. */
+struct warpingPath *optimalWarpingPath(struct problem *p);
+
+/* Find an optimal warping path within the Sakoe-Chiba window of the given
+    problem, whose distance is that of dynamicTimeWarpingWithWindow. For a
+    window of w, memory is O(sqrt(n) w) and time about twice that of
+    computing the cells inside the window once. The path is empty, with an
+    infinite distance, if the window allows none. */
+struct warpingPath *optimalWarpingPathWithWindow(struct problem *p);
+
+/* Free a path. */
+void freeWarpingPath(struct warpingPath *path);
+
+#endif
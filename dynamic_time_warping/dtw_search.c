@@ -0,0 +1,779 @@
+/*
+    Implementation details for module which contains nearest neighbour
+    search under DTW. Each candidate passes through bounds of increasing
+    cost, and is dropped by the first one at or above the best-so-far
+    distance, the distance of the k-th best match, or for subsequences of
+    the k-th closest known to survive trivial match exclusion:
+
+    1. LB_Kim, from the cells every path must visit at both ends.
+    2. LB_Keogh, the distance of each candidate sample from the envelope
+       of the query, visiting the query samples of largest magnitude first
+       so the sum passes the best-so-far as early as possible.
+    3. LB_Keogh again, with the query against the candidate's envelope.
+    4. DTW, abandoned once the least cost in a row plus a lower bound on
+       the rest of the path passes the best-so-far.
+
+    The cost of a cell is the absolute difference of its samples, as in
+    dynamicTimeWarping, so the bounds sum absolute differences rather than
+    the squared ones of the UCR suite.
+*/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtw_search.h"
+
+#define DINFINITY (DBL_MAX / 2.0)
+
+/* Subsequences after which the running sums of a search are recomputed,
+   so rounding does not build up in the mean and deviation. */
+#define SUM_REFRESH (1 << 16)
+
+/* Buffers for the candidates of one search, sized for the query. */
+struct searchWorkspace {
+    int length;
+    int windowSize;
+    /* Normalised query, and its samples and envelope in the order of
+       decreasing magnitude. */
+    double *query;
+    int *order;
+    double *sortedQuery;
+    double *sortedUpper;
+    double *sortedLower;
+    /* Normalised candidate. */
+    double *candidate;
+    /* Lower bound contributed by each position by either LB_Keogh, and
+       their sums from each position to the end. */
+    double *keoghContributions;
+    double *reverseContributions;
+    double *remainingBound;
+    /* Two rows of the DTW matrix. */
+    double *rows;
+};
+
+/* Subsequences of a search that may still be among its matches, in order
+   of position. A subsequence closer than any other within the exclusion
+   zone either side of it is always a match, so once the scan has passed
+   its zone its distance is kept, and the k-th closest kept distance bounds
+   the distance of the k-th match. */
+struct pendingMatches {
+    struct searchResult *candidates;
+    int count;
+    int capacity;
+    /* Candidates before this one have had their zones checked. */
+    int checked;
+    long long exclusion;
+    /* Distances of the k closest candidates known to be matches. */
+    double *kept;
+    int numKept;
+    int k;
+};
+
+/* A query sample and its position, for sorting by magnitude. */
+struct orderedSample {
+    double magnitude;
+    int position;
+};
+
+/* Allocates the buffers of a search and prepares the query, normalising
+   it if asked and computing its envelope. */
+struct searchWorkspace *newSearchWorkspace(double *query, int length,
+                                           int windowSize, int normalise);
+
+/* Frees the buffers of a search. */
+void freeSearchWorkspace(struct searchWorkspace *workspace);
+
+/* Settles one candidate, whose normalised samples are (candidate[i] -
+   mean) / deviation, as are those of its envelope. Returns its DTW
+   distance, or infinity if it was pruned or abandoned. */
+double scoreCandidate(struct searchWorkspace *workspace, double *candidate,
+                      double mean, double deviation, double *upper,
+                      double *lower, double bestSoFar,
+                      struct searchStatistics *stats);
+
+/* Computes LB_Kim from the first two and last two samples of each
+   sequence. */
+double kimBound(double *query, double *candidate, int length);
+
+/* Computes DTW within the window, stopping with infinity once the least
+   cost of a row plus the bound on the rows below passes bestSoFar. */
+double abandoningDistance(struct searchWorkspace *workspace,
+                          double bestSoFar);
+
+/* Adds a match to the results, closest first, keeping at most k. */
+void offerResult(struct searchResult *results, int *numResults, int k,
+                 long long position, double distance);
+
+/* Allocates the pending candidates of a subsequence search. */
+struct pendingMatches *newPendingMatches(int k, long long exclusion);
+
+/* Frees the pending candidates of a search. */
+void freePendingMatches(struct pendingMatches *pending);
+
+/* Returns the distance a candidate must beat to possibly be a match. */
+double pendingBound(struct pendingMatches *pending);
+
+/* Adds a candidate after the last one, dropping those that can no longer
+   be matches when the buffer is full. */
+void addPending(struct pendingMatches *pending, long long position,
+                double distance);
+
+/* Checks the zones of the candidates the scan has passed, given the
+   position of the next subsequence, keeping the distance of each that is
+   closer than all of its neighbours. */
+void checkPending(struct pendingMatches *pending, long long next);
+
+/* Chooses the matches from the candidates, closest first, skipping the
+   trivial matches of those already chosen, and returns their number. */
+int choosePending(struct pendingMatches *pending,
+                  struct searchResult *results);
+
+/* Orders results by distance, then position. */
+int compareResults(const void *a, const void *b);
+
+/* Finds the mean and deviation of a sequence, with 0 and 1 if it is not
+   to be normalised and a deviation of 1 if it is constant. */
+void sequenceMoments(double *sequence, int length, int normalise,
+                     double *mean, double *deviation);
+
+/* Orders query samples by decreasing magnitude. */
+int compareMagnitudes(const void *a, const void *b);
+
+int searchSubsequences(double *query, int queryLength, double *series,
+                       long long seriesLength, int windowSize, int normalise,
+                       int k, struct searchResult *results,
+                       struct searchStatistics *stats) {
+    struct searchStatistics unused;
+    if (!stats) {
+        stats = &unused;
+    }
+    memset(stats, 0, sizeof(struct searchStatistics));
+    if (queryLength < 1 || seriesLength < queryLength || k < 1) {
+        return 0;
+    }
+
+    struct searchWorkspace *workspace =
+        newSearchWorkspace(query, queryLength, windowSize, normalise);
+    double *upper = (double *)malloc(seriesLength * sizeof(double));
+    assert(upper);
+    double *lower = (double *)malloc(seriesLength * sizeof(double));
+    assert(lower);
+    sequenceEnvelope(series, seriesLength, workspace->windowSize, upper,
+                     lower);
+
+    struct pendingMatches *pending =
+        newPendingMatches(k, queryLength / 2);
+    double sum = 0;
+    double squares = 0;
+    for (long long start = 0; start + queryLength <= seriesLength; start++) {
+        double *candidate = series + start;
+        if (start % SUM_REFRESH == 0) {
+            sum = 0;
+            squares = 0;
+            for (int i = 0; i < queryLength; i++) {
+                sum += candidate[i];
+                squares += candidate[i] * candidate[i];
+            }
+        } else {
+            double entering = candidate[queryLength - 1];
+            double leaving = candidate[-1];
+            sum += entering - leaving;
+            squares += entering * entering - leaving * leaving;
+        }
+
+        double mean = 0;
+        double deviation = 1;
+        if (normalise) {
+            mean = sum / queryLength;
+            double variance = squares / queryLength - mean * mean;
+            /* A constant subsequence is only centred, and variance lost
+             * to cancellation is treated as constant. */
+            if (variance > DBL_EPSILON * (mean * mean + 1)) {
+                deviation = sqrt(variance);
+            }
+        }
+
+        double bestSoFar = pendingBound(pending);
+        double distance =
+            scoreCandidate(workspace, candidate, mean, deviation,
+                           upper + start, lower + start, bestSoFar, stats);
+        if (distance < bestSoFar) {
+            addPending(pending, start, distance);
+        }
+        checkPending(pending, start + 1);
+    }
+
+    int numResults = choosePending(pending, results);
+    freePendingMatches(pending);
+    free(upper);
+    free(lower);
+    freeSearchWorkspace(workspace);
+    return numResults;
+}
+
+struct seriesCorpus *newSeriesCorpus(double *series, int numSeries,
+                                     int seriesLength, int windowSize,
+                                     int normalise) {
+    struct seriesCorpus *corpus =
+        (struct seriesCorpus *)malloc(sizeof(struct seriesCorpus));
+    assert(corpus);
+    corpus->numSeries = numSeries;
+    corpus->seriesLength = seriesLength;
+    corpus->windowSize = windowSize;
+    corpus->normalise = normalise;
+
+    size_t size = (size_t)numSeries * seriesLength;
+    corpus->series = (double *)malloc((size + 1) * sizeof(double));
+    assert(corpus->series);
+    corpus->upper = (double *)malloc((size + 1) * sizeof(double));
+    assert(corpus->upper);
+    corpus->lower = (double *)malloc((size + 1) * sizeof(double));
+    assert(corpus->lower);
+
+    for (int s = 0; s < numSeries; s++) {
+        double *source = series + (size_t)s * seriesLength;
+        double *copy = corpus->series + (size_t)s * seriesLength;
+        double mean, deviation;
+        sequenceMoments(source, seriesLength, normalise, &mean, &deviation);
+        for (int i = 0; i < seriesLength; i++) {
+            copy[i] = (source[i] - mean) / deviation;
+        }
+        sequenceEnvelope(copy, seriesLength, windowSize,
+                         corpus->upper + (size_t)s * seriesLength,
+                         corpus->lower + (size_t)s * seriesLength);
+    }
+
+    return corpus;
+}
+
+int searchCorpus(struct seriesCorpus *corpus, double *query, int k,
+                 struct searchResult *results,
+                 struct searchStatistics *stats) {
+    struct searchStatistics unused;
+    if (!stats) {
+        stats = &unused;
+    }
+    memset(stats, 0, sizeof(struct searchStatistics));
+    if (corpus->seriesLength < 1 || k < 1) {
+        return 0;
+    }
+
+    struct searchWorkspace *workspace =
+        newSearchWorkspace(query, corpus->seriesLength, corpus->windowSize,
+                           corpus->normalise);
+
+    int numResults = 0;
+    for (int s = 0; s < corpus->numSeries; s++) {
+        size_t offset = (size_t)s * corpus->seriesLength;
+        double bestSoFar =
+            numResults == k ? results[k - 1].distance : DINFINITY;
+        /* The series were normalised when the corpus was made. */
+        double distance = scoreCandidate(
+            workspace, corpus->series + offset, 0, 1, corpus->upper + offset,
+            corpus->lower + offset, bestSoFar, stats);
+        if (distance < bestSoFar) {
+            offerResult(results, &numResults, k, s, distance);
+        }
+    }
+
+    freeSearchWorkspace(workspace);
+    return numResults;
+}
+
+void freeSeriesCorpus(struct seriesCorpus *corpus) {
+    if (!corpus) {
+        return;
+    }
+    free(corpus->series);
+    free(corpus->upper);
+    free(corpus->lower);
+    free(corpus);
+}
+
+/*
+    Keeps the positions of possible maxima and minima of the window in two
+    deques, each in order of decreasing and increasing value. A sample
+    leaves the back of a deque once a later sample beats it, and the front
+    once it is out of the window, so each sample enters and leaves each
+    deque once. The deques hold positions within one window of 2 *
+    windowSize + 1 samples, so they are circular buffers of that size.
+*/
+void sequenceEnvelope(double *sequence, long long length, int windowSize,
+                      double *upper, double *lower) {
+    if (windowSize < 0) {
+        windowSize = 0;
+    }
+    if (windowSize > length) {
+        windowSize = length;
+    }
+    long long capacity = 2 * (long long)windowSize + 2;
+    long long *maxima = (long long *)malloc(capacity * sizeof(long long));
+    assert(maxima);
+    long long *minima = (long long *)malloc(capacity * sizeof(long long));
+    assert(minima);
+    long long maxFront = 0, maxBack = 0, minFront = 0, minBack = 0;
+
+    for (long long t = 0; t < length + windowSize; t++) {
+        if (t < length) {
+            while (maxBack > maxFront &&
+                   sequence[maxima[(maxBack - 1) % capacity]] <= sequence[t]) {
+                maxBack--;
+            }
+            maxima[maxBack++ % capacity] = t;
+            while (minBack > minFront &&
+                   sequence[minima[(minBack - 1) % capacity]] >= sequence[t]) {
+                minBack--;
+            }
+            minima[minBack++ % capacity] = t;
+        }
+
+        /* The window of position i ends at t = i + windowSize. */
+        long long i = t - windowSize;
+        if (i < 0) {
+            continue;
+        }
+        while (maxima[maxFront % capacity] < i - windowSize) {
+            maxFront++;
+        }
+        while (minima[minFront % capacity] < i - windowSize) {
+            minFront++;
+        }
+        upper[i] = sequence[maxima[maxFront % capacity]];
+        lower[i] = sequence[minima[minFront % capacity]];
+    }
+
+    free(maxima);
+    free(minima);
+}
+
+struct searchWorkspace *newSearchWorkspace(double *query, int length,
+                                           int windowSize, int normalise) {
+    struct searchWorkspace *workspace =
+        (struct searchWorkspace *)malloc(sizeof(struct searchWorkspace));
+    assert(workspace);
+    workspace->length = length;
+    if (windowSize > length - 1) {
+        windowSize = length - 1;
+    }
+    workspace->windowSize = windowSize < 0 ? 0 : windowSize;
+
+    /* One block holds every buffer of doubles. */
+    double *block = (double *)malloc(11 * (size_t)(length + 1) *
+                                     sizeof(double));
+    assert(block);
+    workspace->query = block;
+    workspace->sortedQuery = block + (length + 1);
+    workspace->sortedUpper = block + 2 * (length + 1);
+    workspace->sortedLower = block + 3 * (length + 1);
+    workspace->candidate = block + 4 * (length + 1);
+    workspace->keoghContributions = block + 5 * (length + 1);
+    workspace->reverseContributions = block + 6 * (length + 1);
+    workspace->remainingBound = block + 7 * (length + 1);
+    workspace->rows = block + 8 * (length + 1);
+    double *upper = block + 10 * (length + 1);
+    /* The candidate buffer doubles as the lower envelope until the first
+     * candidate is scored. */
+    double *lower = workspace->candidate;
+
+    double mean, deviation;
+    sequenceMoments(query, length, normalise, &mean, &deviation);
+    for (int i = 0; i < length; i++) {
+        workspace->query[i] = (query[i] - mean) / deviation;
+    }
+    sequenceEnvelope(workspace->query, length, workspace->windowSize, upper,
+                     lower);
+
+    struct orderedSample *samples = (struct orderedSample *)malloc(
+        length * sizeof(struct orderedSample));
+    assert(samples);
+    for (int i = 0; i < length; i++) {
+        samples[i].magnitude = fabs(workspace->query[i]);
+        samples[i].position = i;
+    }
+    qsort(samples, length, sizeof(struct orderedSample), compareMagnitudes);
+
+    workspace->order = (int *)malloc(length * sizeof(int));
+    assert(workspace->order);
+    for (int i = 0; i < length; i++) {
+        int position = samples[i].position;
+        workspace->order[i] = position;
+        workspace->sortedQuery[i] = workspace->query[position];
+        workspace->sortedUpper[i] = upper[position];
+        workspace->sortedLower[i] = lower[position];
+    }
+    free(samples);
+
+    return workspace;
+}
+
+void freeSearchWorkspace(struct searchWorkspace *workspace) {
+    free(workspace->query);
+    free(workspace->order);
+    free(workspace);
+}
+
+double scoreCandidate(struct searchWorkspace *workspace, double *candidate,
+                      double mean, double deviation, double *upper,
+                      double *lower, double bestSoFar,
+                      struct searchStatistics *stats) {
+    int length = workspace->length;
+    int *order = workspace->order;
+    stats->candidates++;
+
+    double *normalised = workspace->candidate;
+    normalised[0] = (candidate[0] - mean) / deviation;
+    normalised[length - 1] = (candidate[length - 1] - mean) / deviation;
+    if (length >= 4) {
+        normalised[1] = (candidate[1] - mean) / deviation;
+        normalised[length - 2] = (candidate[length - 2] - mean) / deviation;
+    }
+    if (kimBound(workspace->query, normalised, length) >= bestSoFar) {
+        stats->prunedByKim++;
+        return DINFINITY;
+    }
+
+    /* LB_Keogh of the candidate against the query envelope, normalising
+     * each candidate sample as it is reached. */
+    double *contributions = workspace->keoghContributions;
+    double keogh = 0;
+    for (int i = 0; i < length; i++) {
+        int position = order[i];
+        double sample = (candidate[position] - mean) / deviation;
+        normalised[position] = sample;
+        double excess = 0;
+        if (sample > workspace->sortedUpper[i]) {
+            excess = sample - workspace->sortedUpper[i];
+        } else if (sample < workspace->sortedLower[i]) {
+            excess = workspace->sortedLower[i] - sample;
+        }
+        contributions[position] = excess;
+        keogh += excess;
+        if (keogh >= bestSoFar) {
+            stats->prunedByKeogh++;
+            return DINFINITY;
+        }
+    }
+
+    /* LB_Keogh of the query against the candidate envelope. */
+    double *reverse = workspace->reverseContributions;
+    double reverseKeogh = 0;
+    for (int i = 0; i < length; i++) {
+        int position = order[i];
+        double sample = workspace->sortedQuery[i];
+        double high = (upper[position] - mean) / deviation;
+        double low = (lower[position] - mean) / deviation;
+        double excess = 0;
+        if (sample > high) {
+            excess = sample - high;
+        } else if (sample < low) {
+            excess = low - sample;
+        }
+        reverse[position] = excess;
+        reverseKeogh += excess;
+        if (reverseKeogh >= bestSoFar) {
+            stats->prunedByReverseKeogh++;
+            return DINFINITY;
+        }
+    }
+
+    /* The tighter bound gives the bound on the rest of the path used to
+     * abandon DTW. */
+    if (reverseKeogh > keogh) {
+        contributions = reverse;
+    }
+    workspace->remainingBound[length] = 0;
+    for (int i = length - 1; i >= 0; i--) {
+        workspace->remainingBound[i] =
+            workspace->remainingBound[i + 1] + contributions[i];
+    }
+
+    double distance = abandoningDistance(workspace, bestSoFar);
+    if (distance >= DINFINITY) {
+        stats->abandoned++;
+    } else {
+        stats->computed++;
+    }
+    return distance;
+}
+
+/*
+    Every path visits the first and last cells, and one of the three cells
+    after the first and before the last. These cells are distinct once
+    both sequences have at least 4 samples.
+*/
+double kimBound(double *query, double *candidate, int length) {
+    double bound = fabs(query[0] - candidate[0]);
+    if (length == 1) {
+        return bound;
+    }
+    bound += fabs(query[length - 1] - candidate[length - 1]);
+    if (length < 4) {
+        return bound;
+    }
+
+    double second = fabs(query[1] - candidate[0]);
+    if (fabs(query[0] - candidate[1]) < second) {
+        second = fabs(query[0] - candidate[1]);
+    }
+    if (fabs(query[1] - candidate[1]) < second) {
+        second = fabs(query[1] - candidate[1]);
+    }
+    int last = length - 1;
+    double penultimate = fabs(query[last - 1] - candidate[last]);
+    if (fabs(query[last] - candidate[last - 1]) < penultimate) {
+        penultimate = fabs(query[last] - candidate[last - 1]);
+    }
+    if (fabs(query[last - 1] - candidate[last - 1]) < penultimate) {
+        penultimate = fabs(query[last - 1] - candidate[last - 1]);
+    }
+    return bound + second + penultimate;
+}
+
+/*
+    Computes DTW with the query along the rows, keeping two rows. A path
+    through row i only reaches columns up to i + windowSize, so every
+    position after that is aligned below row i, and remainingBound of the
+    next position bounds the cost still to come.
+*/
+double abandoningDistance(struct searchWorkspace *workspace,
+                          double bestSoFar) {
+    int length = workspace->length;
+    int windowSize = workspace->windowSize;
+    double *query = workspace->query;
+    double *candidate = workspace->candidate;
+    double *previous = workspace->rows;
+    double *current = workspace->rows + (length + 1);
+
+    for (int j = 0; j <= length; j++) {
+        previous[j] = DINFINITY;
+        current[j] = DINFINITY;
+    }
+    previous[0] = 0;
+
+    for (int i = 1; i <= length; i++) {
+        int first = i - windowSize > 1 ? i - windowSize : 1;
+        int last = i + windowSize < length ? i + windowSize : length;
+        /* This row last held row i - 2, whose band reached one column
+         * further left. */
+        current[first - 1] = DINFINITY;
+        double rowMinimum = DINFINITY;
+        for (int j = first; j <= last; j++) {
+            double best = previous[j] < current[j - 1] ? previous[j]
+                                                       : current[j - 1];
+            if (previous[j - 1] < best) {
+                best = previous[j - 1];
+            }
+            current[j] = fabs(query[i - 1] - candidate[j - 1]) + best;
+            if (current[j] < rowMinimum) {
+                rowMinimum = current[j];
+            }
+        }
+        if (last < length &&
+            rowMinimum + workspace->remainingBound[last] >= bestSoFar) {
+            return DINFINITY;
+        }
+
+        double *swap = previous;
+        previous = current;
+        current = swap;
+    }
+
+    return previous[length];
+}
+
+void offerResult(struct searchResult *results, int *numResults, int k,
+                 long long position, double distance) {
+    if (*numResults == k && results[k - 1].distance <= distance) {
+        return;
+    }
+
+    /* When full, the furthest match makes way for the new one. */
+    int slot = *numResults < k ? *numResults : k - 1;
+    while (slot > 0 && results[slot - 1].distance > distance) {
+        results[slot] = results[slot - 1];
+        slot--;
+    }
+    results[slot].position = position;
+    results[slot].distance = distance;
+    if (*numResults < k) {
+        (*numResults)++;
+    }
+}
+
+struct pendingMatches *newPendingMatches(int k, long long exclusion) {
+    struct pendingMatches *pending =
+        (struct pendingMatches *)malloc(sizeof(struct pendingMatches));
+    assert(pending);
+    pending->capacity = 1024;
+    pending->candidates = (struct searchResult *)malloc(
+        pending->capacity * sizeof(struct searchResult));
+    assert(pending->candidates);
+    pending->count = 0;
+    pending->checked = 0;
+    pending->exclusion = exclusion;
+    pending->kept = (double *)malloc(k * sizeof(double));
+    assert(pending->kept);
+    pending->numKept = 0;
+    pending->k = k;
+    return pending;
+}
+
+void freePendingMatches(struct pendingMatches *pending) {
+    free(pending->candidates);
+    free(pending->kept);
+    free(pending);
+}
+
+double pendingBound(struct pendingMatches *pending) {
+    return pending->numKept == pending->k ? pending->kept[pending->k - 1]
+                                          : DINFINITY;
+}
+
+/*
+    A candidate past the bound is further than the k-th match, so it is not
+    a match and cannot exclude one, and is dropped. The buffer only
+    grows if at least half of it is still below the bound.
+*/
+void addPending(struct pendingMatches *pending, long long position,
+                double distance) {
+    if (pending->count == pending->capacity) {
+        double bound = pendingBound(pending);
+        int kept = 0;
+        int checked = 0;
+        for (int c = 0; c < pending->count; c++) {
+            if (pending->candidates[c].distance <= bound) {
+                pending->candidates[kept++] = pending->candidates[c];
+            }
+            if (c + 1 == pending->checked) {
+                checked = kept;
+            }
+        }
+        pending->count = kept;
+        pending->checked = checked;
+        if (2 * kept > pending->capacity) {
+            pending->capacity *= 2;
+            pending->candidates = (struct searchResult *)realloc(
+                pending->candidates,
+                pending->capacity * sizeof(struct searchResult));
+            assert(pending->candidates);
+        }
+    }
+    pending->candidates[pending->count].position = position;
+    pending->candidates[pending->count].distance = distance;
+    pending->count++;
+}
+
+/*
+    The zone of a candidate is complete once the scan is exclusion
+    positions past it. Neighbours that were pruned, or dropped, were at or
+    past the bound at the time, which only comes down, so a candidate below
+    the current bound is closer than them too. Candidates that tie with a
+    neighbour are not kept, which only leaves the bound higher.
+*/
+void checkPending(struct pendingMatches *pending, long long next) {
+    struct searchResult *candidates = pending->candidates;
+    long long exclusion = pending->exclusion;
+    while (pending->checked < pending->count &&
+           candidates[pending->checked].position + exclusion <= next) {
+        int c = pending->checked++;
+        double distance = candidates[c].distance;
+        if (distance >= pendingBound(pending)) {
+            continue;
+        }
+        int closest = 1;
+        for (int n = c - 1; closest && n >= 0 &&
+                            candidates[c].position - candidates[n].position <
+                                exclusion;
+             n--) {
+            closest = candidates[n].distance > distance;
+        }
+        for (int n = c + 1; closest && n < pending->count &&
+                            candidates[n].position - candidates[c].position <
+                                exclusion;
+             n++) {
+            closest = candidates[n].distance > distance;
+        }
+        if (!closest) {
+            continue;
+        }
+
+        int slot = pending->numKept < pending->k ? pending->numKept++
+                                                 : pending->k - 1;
+        while (slot > 0 && pending->kept[slot - 1] > distance) {
+            pending->kept[slot] = pending->kept[slot - 1];
+            slot--;
+        }
+        pending->kept[slot] = distance;
+    }
+}
+
+/*
+    No match is past the bound, so choosing greedily among the candidates
+    within it gives the same matches as choosing among all subsequences.
+*/
+int choosePending(struct pendingMatches *pending,
+                  struct searchResult *results) {
+    double bound = pendingBound(pending);
+    int count = 0;
+    for (int c = 0; c < pending->count; c++) {
+        if (pending->candidates[c].distance <= bound) {
+            pending->candidates[count++] = pending->candidates[c];
+        }
+    }
+    qsort(pending->candidates, count, sizeof(struct searchResult),
+          compareResults);
+
+    int numResults = 0;
+    for (int c = 0; c < count && numResults < pending->k; c++) {
+        int trivial = 0;
+        for (int r = 0; r < numResults && !trivial; r++) {
+            trivial = llabs(results[r].position -
+                            pending->candidates[c].position) <
+                      pending->exclusion;
+        }
+        if (!trivial) {
+            results[numResults++] = pending->candidates[c];
+        }
+    }
+    return numResults;
+}
+
+int compareResults(const void *a, const void *b) {
+    struct searchResult *first = (struct searchResult *)a;
+    struct searchResult *second = (struct searchResult *)b;
+    if (first->distance != second->distance) {
+        return first->distance < second->distance ? -1 : 1;
+    }
+    return (first->position > second->position) -
+           (first->position < second->position);
+}
+
+void sequenceMoments(double *sequence, int length, int normalise,
+                     double *mean, double *deviation) {
+    *mean = 0;
+    *deviation = 1;
+    if (!normalise || length < 1) {
+        return;
+    }
+    double sum = 0;
+    for (int i = 0; i < length; i++) {
+        sum += sequence[i];
+    }
+    *mean = sum / length;
+    double squares = 0;
+    for (int i = 0; i < length; i++) {
+        squares += (sequence[i] - *mean) * (sequence[i] - *mean);
+    }
+    if (squares > 0) {
+        *deviation = sqrt(squares / length);
+    }
+}
+
+int compareMagnitudes(const void *a, const void *b) {
+    double first = ((struct orderedSample *)a)->magnitude;
+    double second = ((struct orderedSample *)b)->magnitude;
+    return (first < second) - (first > second);
+}
@@ -0,0 +1,83 @@
+/*
+    Header for module which contains nearest neighbour search under DTW
+    with a Sakoe-Chiba window, in the style of the UCR suite. Candidates
+    are z-normalised as they are visited and pruned by a cascade of lower
+    bounds, LB_Kim and LB_Keogh in both directions, before DTW is computed,
+    and DTW itself is abandoned once it cannot beat the k-th best match.
+*/
+
+#ifndef DTW_SEARCH_H
+#define DTW_SEARCH_H
+
+/* A match found by a search, at the start of a subsequence or the index of
+    a series in a corpus. */
+struct searchResult {
+    long long position;
+    double distance;
+};
+
+/* How the candidates of a search were settled. */
+struct searchStatistics {
+    long long candidates;
+    /* Pruned by LB_Kim on the first and last samples. */
+    long long prunedByKim;
+    /* Pruned by LB_Keogh of the candidate against the query envelope. */
+    long long prunedByKeogh;
+    /* Pruned by LB_Keogh of the query against the candidate envelope. */
+    long long prunedByReverseKeogh;
+    /* DTW abandoned once it could no longer beat the k-th best match. */
+    long long abandoned;
+    /* DTW computed to the end. */
+    long long computed;
+};
+
+/* A set of series of the same length prepared for repeated searches, with
+    each series normalised and its envelope computed once. */
+struct seriesCorpus {
+    int numSeries;
+    int seriesLength;
+    int windowSize;
+    int normalise;
+    /* Series i and its envelope start at i * seriesLength. */
+    double *series;
+    double *upper;
+    double *lower;
+};
+
+/* Find the k subsequences of length queryLength of a series closest to the
+    query under DTW with a window of windowSize cells either side of the
+    diagonal, as in dynamicTimeWarpingWithWindow. If normalise is set, the
+    query and every subsequence are z-normalised first, and constant ones
+    are only centred. Subsequences closer together than half the query
+    length are trivial matches of each other, so the matches are chosen
+    closest first, skipping the trivial matches of those already chosen.
+    They are written to results, closest first, and their number is
+    returned. stats, if not NULL, is filled in. */
+int searchSubsequences(double *query, int queryLength, double *series,
+                       long long seriesLength, int windowSize, int normalise,
+                       int k, struct searchResult *results,
+                       struct searchStatistics *stats);
+
+/* Prepare numSeries series of seriesLength samples, stored one after the
+    other, for searchCorpus. The series are copied. */
+struct seriesCorpus *newSeriesCorpus(double *series, int numSeries,
+                                     int seriesLength, int windowSize,
+                                     int normalise);
+
+/* Find the k series of a corpus closest to a query of the corpus' series
+    length, as searchSubsequences does for subsequences. Every series is a
+    candidate, however close to another. */
+int searchCorpus(struct seriesCorpus *corpus, double *query, int k,
+                 struct searchResult *results,
+                 struct searchStatistics *stats);
+
+/* Free a corpus and its series. */
+void freeSeriesCorpus(struct seriesCorpus *corpus);
+
+/* Compute the envelope of a sequence for a window of windowSize samples
+    either side, the greatest and least sample within the window of each
+    sample, in linear time. */
+void sequenceEnvelope(double *sequence, long long length, int windowSize,
+                      double *upper, double *lower);
+
+#endif
@@ -0,0 +1,571 @@
+/*
+    Implementation details for module which contains streaming subsequence
+    matching with SPRING. Each pattern runs down the rows of a cost matrix
+    whose columns are the samples of the stream, and a path may start at
+    any sample: the row above the pattern costs 0 everywhere. Each cell
+    also keeps the sample its cheapest path started at, so the column at
+    the newest sample says, for every row, how cheaply and from where the
+    pattern so far can be aligned with a subsequence ending there.
+
+    The rows of a column depend on each other in turn, so a single pattern
+    keeps the processor waiting on each cell. The patterns are instead
+    sorted by length and interleaved in groups of STREAM_LANES, with the
+    samples and cells of row i of every pattern of a group side by side,
+    and the patterns of a group are computed together, row by row.
+
+    Once a match is reported, its pattern's column is recomputed from the
+    sample after the match, as if the stream began there, so that the
+    paths which only lost to one overlapping the match are found again.
+    The samples after the end of the oldest pending match are kept for
+    this.
+*/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dtw_stream.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define STREAM_X86
+#endif
+
+#define DINFINITY (DBL_MAX / 2.0)
+
+/* Patterns computed together in a group, one per double of an AVX2
+   register. */
+#define STREAM_LANES (4)
+
+struct streamMatcher {
+    int numPatterns;
+    int numGroups;
+    /* Lane l of group g is slot g * STREAM_LANES + l, which holds the
+       pattern slotPattern[slot] of length slotLength[slot], or no pattern
+       and length 0. */
+    int *slotPattern;
+    int *slotLength;
+    double *slotThreshold;
+    /* Row i of group g is at groupStart[g] + i * STREAM_LANES + l in the
+       samples, cells and starts, for the group's groupLength[g] rows. A
+       pattern shorter than its group has rows past its end, which are
+       computed but never read. */
+    int *groupLength;
+    size_t *groupStart;
+    double *samples;
+    double *cells;
+    long long *starts;
+    /* The closest match of each slot not yet reported, if pendingEnd is
+       not negative. */
+    double *pendingDistance;
+    long long *pendingStart;
+    long long *pendingEnd;
+    /* Position of the next sample. */
+    long long time;
+    /* The samples from historyTime on, from history[historyOffset] to
+       history[historyLength - 1]. */
+    double *history;
+    size_t historyOffset;
+    size_t historyLength;
+    size_t historyCapacity;
+    long long historyTime;
+    /* Whether groups are computed with advanceGroupAvx2. */
+    int vectorised;
+};
+
+/* A pattern, to be ordered by its length. */
+struct orderedPattern {
+    int length;
+    int pattern;
+};
+
+/* Computes the column of each pattern of a group at the newest sample. */
+void advanceGroup(struct streamMatcher *matcher, int group, double sample);
+
+#ifdef STREAM_X86
+/* Computes the columns of a group as advanceGroup does, with the lanes of
+   the group in the lanes of AVX2 registers. */
+void advanceGroupAvx2(double *samples, double *cells, long long *starts,
+                      int length, double sample, long long time);
+#endif
+
+/* Computes the column of the pattern in a slot at the given sample and
+   position, as advanceGroup does for its lane. */
+void advanceSlot(struct streamMatcher *matcher, int slot, double sample,
+                 long long time);
+
+/* Updates the pending match of a slot after a new column, writing it to
+   match and returning 1 if it is settled. */
+int settleSlot(struct streamMatcher *matcher, int slot,
+               struct streamMatch *match);
+
+/* Makes the match ending at the last cell of a slot's column, at the given
+   position, pending if it is within the threshold and closer than the
+   pending match. */
+void offerMatch(struct streamMatcher *matcher, int slot, long long end);
+
+/* Recomputes the column of a slot from the sample after end to the newest,
+   starting from a column of infinite cells. */
+void replaySlot(struct streamMatcher *matcher, int slot, long long end);
+
+/* Appends a sample to the history. */
+void appendHistory(struct streamMatcher *matcher, double sample);
+
+/* Drops the samples no pending match can need replayed. */
+void trimHistory(struct streamMatcher *matcher);
+
+/* Sets every cell of the matcher to infinity and drops pending matches. */
+void clearColumns(struct streamMatcher *matcher);
+
+/* Orders patterns by decreasing length, then by index. */
+int compareLengths(const void *a, const void *b);
+
+/* Orders matches by pattern. */
+int compareMatches(const void *a, const void *b);
+
+struct streamMatcher *newStreamMatcher(double **patterns, int *lengths,
+                                       int numPatterns, double *thresholds) {
+    struct streamMatcher *matcher =
+        (struct streamMatcher *)malloc(sizeof(struct streamMatcher));
+    assert(matcher);
+    matcher->numPatterns = numPatterns;
+    matcher->numGroups = (numPatterns + STREAM_LANES - 1) / STREAM_LANES;
+    matcher->time = 0;
+    matcher->historyCapacity = 64;
+    matcher->history =
+        (double *)malloc(matcher->historyCapacity * sizeof(double));
+    assert(matcher->history);
+    matcher->vectorised = 0;
+#ifdef STREAM_X86
+    __builtin_cpu_init();
+    matcher->vectorised = __builtin_cpu_supports("avx2");
+#endif
+
+    int slots = matcher->numGroups * STREAM_LANES;
+    matcher->slotPattern = (int *)malloc((slots + 1) * sizeof(int));
+    assert(matcher->slotPattern);
+    matcher->slotLength = (int *)malloc((slots + 1) * sizeof(int));
+    assert(matcher->slotLength);
+    matcher->slotThreshold = (double *)malloc((slots + 1) * sizeof(double));
+    assert(matcher->slotThreshold);
+    matcher->pendingDistance = (double *)malloc((slots + 1) * sizeof(double));
+    assert(matcher->pendingDistance);
+    matcher->pendingStart =
+        (long long *)malloc((slots + 1) * sizeof(long long));
+    assert(matcher->pendingStart);
+    matcher->pendingEnd = (long long *)malloc((slots + 1) * sizeof(long long));
+    assert(matcher->pendingEnd);
+    matcher->groupLength =
+        (int *)malloc((matcher->numGroups + 1) * sizeof(int));
+    assert(matcher->groupLength);
+    matcher->groupStart =
+        (size_t *)malloc((matcher->numGroups + 1) * sizeof(size_t));
+    assert(matcher->groupStart);
+
+    /* Patterns of similar lengths share a group, so little of a group is
+     * spent on rows past the end of its shorter patterns. */
+    struct orderedPattern *ordered = (struct orderedPattern *)malloc(
+        (numPatterns + 1) * sizeof(struct orderedPattern));
+    assert(ordered);
+    for (int s = 0; s < numPatterns; s++) {
+        ordered[s].length = lengths[s];
+        ordered[s].pattern = s;
+    }
+    qsort(ordered, numPatterns, sizeof(struct orderedPattern),
+          compareLengths);
+    for (int s = 0; s < numPatterns; s++) {
+        matcher->slotPattern[s] = ordered[s].pattern;
+    }
+    free(ordered);
+    for (int s = 0; s < slots; s++) {
+        if (s < numPatterns) {
+            matcher->slotLength[s] = lengths[matcher->slotPattern[s]];
+            matcher->slotThreshold[s] = thresholds[matcher->slotPattern[s]];
+        } else {
+            matcher->slotPattern[s] = -1;
+            matcher->slotLength[s] = 0;
+            matcher->slotThreshold[s] = 0;
+        }
+    }
+
+    size_t size = 0;
+    for (int g = 0; g < matcher->numGroups; g++) {
+        matcher->groupLength[g] = matcher->slotLength[g * STREAM_LANES];
+        matcher->groupStart[g] = size;
+        size += (size_t)matcher->groupLength[g] * STREAM_LANES;
+    }
+    matcher->groupStart[matcher->numGroups] = size;
+    matcher->samples = (double *)malloc((size + 1) * sizeof(double));
+    assert(matcher->samples);
+    matcher->cells = (double *)malloc((size + 1) * sizeof(double));
+    assert(matcher->cells);
+    matcher->starts = (long long *)malloc((size + 1) * sizeof(long long));
+    assert(matcher->starts);
+
+    for (int g = 0; g < matcher->numGroups; g++) {
+        for (int l = 0; l < STREAM_LANES; l++) {
+            int slot = g * STREAM_LANES + l;
+            double *pattern = matcher->slotPattern[slot] >= 0
+                                  ? patterns[matcher->slotPattern[slot]]
+                                  : NULL;
+            for (int i = 0; i < matcher->groupLength[g]; i++) {
+                matcher->samples[matcher->groupStart[g] + i * STREAM_LANES +
+                                 l] = i < matcher->slotLength[slot]
+                                          ? pattern[i]
+                                          : 0;
+            }
+        }
+    }
+    clearColumns(matcher);
+
+    return matcher;
+}
+
+int pushStreamSample(struct streamMatcher *matcher, double sample,
+                     struct streamMatch *matches) {
+    int count = 0;
+    appendHistory(matcher, sample);
+    for (int g = 0; g < matcher->numGroups; g++) {
+        advanceGroup(matcher, g, sample);
+        for (int l = 0; l < STREAM_LANES; l++) {
+            int slot = g * STREAM_LANES + l;
+            if (matcher->slotLength[slot] > 0 &&
+                settleSlot(matcher, slot, &matches[count])) {
+                count++;
+            }
+        }
+    }
+    matcher->time++;
+    trimHistory(matcher);
+
+    qsort(matches, count, sizeof(struct streamMatch), compareMatches);
+    return count;
+}
+
+int flushStreamMatcher(struct streamMatcher *matcher,
+                       struct streamMatch *matches) {
+    int count = 0;
+    for (int slot = 0; slot < matcher->numGroups * STREAM_LANES; slot++) {
+        if (matcher->pendingEnd[slot] >= 0) {
+            matches[count].pattern = matcher->slotPattern[slot];
+            matches[count].start = matcher->pendingStart[slot];
+            matches[count].end = matcher->pendingEnd[slot];
+            matches[count].distance = matcher->pendingDistance[slot];
+            count++;
+        }
+    }
+    clearColumns(matcher);
+
+    qsort(matches, count, sizeof(struct streamMatch), compareMatches);
+    return count;
+}
+
+void freeStreamMatcher(struct streamMatcher *matcher) {
+    if (!matcher) {
+        return;
+    }
+    free(matcher->slotPattern);
+    free(matcher->slotLength);
+    free(matcher->slotThreshold);
+    free(matcher->pendingDistance);
+    free(matcher->pendingStart);
+    free(matcher->pendingEnd);
+    free(matcher->groupLength);
+    free(matcher->groupStart);
+    free(matcher->samples);
+    free(matcher->cells);
+    free(matcher->starts);
+    free(matcher->history);
+    free(matcher);
+}
+
+/*
+    Cell i of the new column takes the cheapest of the cell above it in
+    the new column, the cell beside it in the old column and the cell
+    between them, the same three moves as dynamicTimeWarping. The row
+    above the pattern is 0 in every column and starts at the new sample,
+    so the first row can always begin a new match. On ties the path that
+    started later is kept, so matches are as short as they can be.
+*/
+void advanceGroup(struct streamMatcher *matcher, int group, double sample) {
+    double *samples = matcher->samples + matcher->groupStart[group];
+    double *cells = matcher->cells + matcher->groupStart[group];
+    long long *starts = matcher->starts + matcher->groupStart[group];
+    long long time = matcher->time;
+#ifdef STREAM_X86
+    if (matcher->vectorised) {
+        advanceGroupAvx2(samples, cells, starts, matcher->groupLength[group],
+                         sample, time);
+        return;
+    }
+#endif
+
+    double above[STREAM_LANES];
+    double diagonal[STREAM_LANES];
+    long long aboveStart[STREAM_LANES];
+    long long diagonalStart[STREAM_LANES];
+    for (int l = 0; l < STREAM_LANES; l++) {
+        above[l] = 0;
+        diagonal[l] = 0;
+        aboveStart[l] = time;
+        diagonalStart[l] = time;
+    }
+
+    for (int i = 0; i < matcher->groupLength[group]; i++) {
+        for (int l = 0; l < STREAM_LANES; l++) {
+            int k = i * STREAM_LANES + l;
+            double best = diagonal[l];
+            long long bestStart = diagonalStart[l];
+            if (cells[k] < best ||
+                (cells[k] == best && starts[k] > bestStart)) {
+                best = cells[k];
+                bestStart = starts[k];
+            }
+            if (above[l] < best ||
+                (above[l] == best && aboveStart[l] > bestStart)) {
+                best = above[l];
+                bestStart = aboveStart[l];
+            }
+            diagonal[l] = cells[k];
+            diagonalStart[l] = starts[k];
+            above[l] = fabs(sample - samples[k]) + best;
+            aboveStart[l] = bestStart;
+            cells[k] = above[l];
+            starts[k] = bestStart;
+        }
+    }
+}
+
+#ifdef STREAM_X86
+__attribute__((target("avx2"))) void advanceGroupAvx2(double *samples,
+                                                      double *cells,
+                                                      long long *starts,
+                                                      int length,
+                                                      double sample,
+                                                      long long time) {
+    __m256d above = _mm256_setzero_pd();
+    __m256d diagonal = _mm256_setzero_pd();
+    __m256i aboveStart = _mm256_set1_epi64x(time);
+    __m256i diagonalStart = aboveStart;
+    __m256d value = _mm256_set1_pd(sample);
+    /* Clearing the sign bit gives the absolute value. */
+    __m256d signBit = _mm256_set1_pd(-0.0);
+
+    for (int i = 0; i < length; i++) {
+        double *cell = cells + i * STREAM_LANES;
+        __m256i *start = (__m256i *)(starts + i * STREAM_LANES);
+        __m256d beside = _mm256_loadu_pd(cell);
+        __m256i besideStart = _mm256_loadu_si256(start);
+
+        /* Only the cost of the cell above depends on the row before, so
+         * the cheapest cost is taken with min, and the start it came
+         * from, the later one on a tie, is blended in alongside. */
+        __m256d take = _mm256_or_pd(
+            _mm256_cmp_pd(beside, diagonal, _CMP_LT_OQ),
+            _mm256_and_pd(_mm256_cmp_pd(beside, diagonal, _CMP_EQ_OQ),
+                          _mm256_castsi256_pd(_mm256_cmpgt_epi64(
+                              besideStart, diagonalStart))));
+        __m256d best = _mm256_min_pd(beside, diagonal);
+        __m256d bestStart =
+            _mm256_blendv_pd(_mm256_castsi256_pd(diagonalStart),
+                             _mm256_castsi256_pd(besideStart), take);
+        take = _mm256_or_pd(
+            _mm256_cmp_pd(above, best, _CMP_LT_OQ),
+            _mm256_and_pd(_mm256_cmp_pd(above, best, _CMP_EQ_OQ),
+                          _mm256_castsi256_pd(_mm256_cmpgt_epi64(
+                              aboveStart, _mm256_castpd_si256(bestStart)))));
+        bestStart =
+            _mm256_blendv_pd(bestStart, _mm256_castsi256_pd(aboveStart), take);
+        best = _mm256_min_pd(above, best);
+
+        diagonal = beside;
+        diagonalStart = besideStart;
+        __m256d cost = _mm256_andnot_pd(
+            signBit,
+            _mm256_sub_pd(value, _mm256_loadu_pd(samples + i * STREAM_LANES)));
+        above = _mm256_add_pd(cost, best);
+        aboveStart = _mm256_castpd_si256(bestStart);
+        _mm256_storeu_pd(cell, above);
+        _mm256_storeu_si256(start, aboveStart);
+    }
+}
+#endif
+
+void advanceSlot(struct streamMatcher *matcher, int slot, double sample,
+                 long long time) {
+    size_t offset = matcher->groupStart[slot / STREAM_LANES] +
+                    slot % STREAM_LANES;
+    double *samples = matcher->samples + offset;
+    double *cells = matcher->cells + offset;
+    long long *starts = matcher->starts + offset;
+
+    double above = 0;
+    double diagonal = 0;
+    long long aboveStart = time;
+    long long diagonalStart = time;
+    for (int i = 0; i < matcher->slotLength[slot]; i++) {
+        int k = i * STREAM_LANES;
+        double best = diagonal;
+        long long bestStart = diagonalStart;
+        if (cells[k] < best || (cells[k] == best && starts[k] > bestStart)) {
+            best = cells[k];
+            bestStart = starts[k];
+        }
+        if (above < best || (above == best && aboveStart > bestStart)) {
+            best = above;
+            bestStart = aboveStart;
+        }
+        diagonal = cells[k];
+        diagonalStart = starts[k];
+        above = fabs(sample - samples[k]) + best;
+        aboveStart = bestStart;
+        cells[k] = above;
+        starts[k] = bestStart;
+    }
+}
+
+/*
+    A pending match is settled once every cell of the column is either no
+    closer than it or on a path starting after it ends, since then no path
+    overlapping it can end closer later on. The next match of the pattern
+    must start after it, but clearing the cells on paths overlapping it is
+    not enough: a cell keeps only its cheapest path, and the cheapest of
+    those starting after the match may have been dropped for one that
+    overlaps it. The column is instead replayed without them.
+*/
+int settleSlot(struct streamMatcher *matcher, int slot,
+               struct streamMatch *match) {
+    int group = slot / STREAM_LANES;
+    int lane = slot % STREAM_LANES;
+    int length = matcher->slotLength[slot];
+    double *cells = matcher->cells + matcher->groupStart[group] + lane;
+    long long *starts = matcher->starts + matcher->groupStart[group] + lane;
+    int settled = 0;
+
+    if (matcher->pendingEnd[slot] >= 0) {
+        settled = 1;
+        for (int i = 0; i < length && settled; i++) {
+            if (cells[i * STREAM_LANES] < matcher->pendingDistance[slot] &&
+                starts[i * STREAM_LANES] <= matcher->pendingEnd[slot]) {
+                settled = 0;
+            }
+        }
+        if (settled) {
+            match->pattern = matcher->slotPattern[slot];
+            match->start = matcher->pendingStart[slot];
+            match->end = matcher->pendingEnd[slot];
+            match->distance = matcher->pendingDistance[slot];
+            matcher->pendingEnd[slot] = -1;
+            matcher->pendingDistance[slot] = DINFINITY;
+            replaySlot(matcher, slot, match->end);
+        }
+    }
+
+    offerMatch(matcher, slot, matcher->time);
+    return settled;
+}
+
+void offerMatch(struct streamMatcher *matcher, int slot, long long end) {
+    size_t last = matcher->groupStart[slot / STREAM_LANES] +
+                  (size_t)(matcher->slotLength[slot] - 1) * STREAM_LANES +
+                  slot % STREAM_LANES;
+    double distance = matcher->cells[last];
+    if (distance <= matcher->slotThreshold[slot] && distance < DINFINITY &&
+        (matcher->pendingEnd[slot] < 0 ||
+         distance < matcher->pendingDistance[slot])) {
+        matcher->pendingDistance[slot] = distance;
+        matcher->pendingStart[slot] = matcher->starts[last];
+        matcher->pendingEnd[slot] = end;
+    }
+}
+
+/*
+    No path can start after end and reach the column at end, so the column
+    there is infinite. The matches the replay ends on are offered as they
+    were at the time, but only settled from the next sample on, so that at
+    most one match of each pattern is reported per sample.
+*/
+void replaySlot(struct streamMatcher *matcher, int slot, long long end) {
+    size_t offset = matcher->groupStart[slot / STREAM_LANES] +
+                    slot % STREAM_LANES;
+    for (int i = 0; i < matcher->slotLength[slot]; i++) {
+        matcher->cells[offset + (size_t)i * STREAM_LANES] = DINFINITY;
+        matcher->starts[offset + (size_t)i * STREAM_LANES] = 0;
+    }
+
+    double *samples = matcher->history + matcher->historyOffset;
+    for (long long t = end + 1; t <= matcher->time; t++) {
+        advanceSlot(matcher, slot, samples[t - matcher->historyTime], t);
+        if (t < matcher->time) {
+            offerMatch(matcher, slot, t);
+        }
+    }
+}
+
+void clearColumns(struct streamMatcher *matcher) {
+    size_t size = matcher->groupStart[matcher->numGroups];
+    for (size_t k = 0; k < size; k++) {
+        matcher->cells[k] = DINFINITY;
+        matcher->starts[k] = 0;
+    }
+    for (int slot = 0; slot < matcher->numGroups * STREAM_LANES; slot++) {
+        matcher->pendingDistance[slot] = DINFINITY;
+        matcher->pendingStart[slot] = 0;
+        matcher->pendingEnd[slot] = -1;
+    }
+    matcher->historyOffset = 0;
+    matcher->historyLength = 0;
+    matcher->historyTime = matcher->time;
+}
+
+/*
+    Once the samples before historyOffset are at least as many as those
+    after it, moving the latter down instead of growing the history takes
+    time no more than linear in the samples appended since the last move.
+*/
+void appendHistory(struct streamMatcher *matcher, double sample) {
+    if (matcher->historyLength == matcher->historyCapacity) {
+        size_t kept = matcher->historyLength - matcher->historyOffset;
+        if (matcher->historyOffset >= kept) {
+            memmove(matcher->history,
+                    matcher->history + matcher->historyOffset,
+                    kept * sizeof(double));
+            matcher->historyOffset = 0;
+            matcher->historyLength = kept;
+        } else {
+            matcher->historyCapacity *= 2;
+            matcher->history = (double *)realloc(
+                matcher->history, matcher->historyCapacity * sizeof(double));
+            assert(matcher->history);
+        }
+    }
+    matcher->history[matcher->historyLength++] = sample;
+}
+
+void trimHistory(struct streamMatcher *matcher) {
+    long long oldest = matcher->time;
+    for (int slot = 0; slot < matcher->numGroups * STREAM_LANES; slot++) {
+        if (matcher->pendingEnd[slot] >= 0 &&
+            matcher->pendingEnd[slot] + 1 < oldest) {
+            oldest = matcher->pendingEnd[slot] + 1;
+        }
+    }
+    matcher->historyOffset += (size_t)(oldest - matcher->historyTime);
+    matcher->historyTime = oldest;
+}
+
+int compareLengths(const void *a, const void *b) {
+    struct orderedPattern *first = (struct orderedPattern *)a;
+    struct orderedPattern *second = (struct orderedPattern *)b;
+    if (first->length != second->length) {
+        return first->length > second->length ? -1 : 1;
+    }
+    return first->pattern - second->pattern;
+}
+
+int compareMatches(const void *a, const void *b) {
+    return ((const struct streamMatch *)a)->pattern -
+           ((const struct streamMatch *)b)->pattern;
+}
@@ -0,0 +1,48 @@
+/*
+    Header for module which contains streaming subsequence matching under
+    DTW with the SPRING algorithm. Patterns are matched against a stream
+    one sample at a time, keeping a single column of the cost matrix of
+    each pattern, so each sample costs time linear in the total length of
+    the patterns. The only samples kept are those after the end of the
+    oldest match not yet reported, which are replayed once it is.
+*/
+
+#ifndef DTW_STREAM_H
+#define DTW_STREAM_H
+
+struct streamMatcher;
+
+/* A subsequence of the stream, the samples start to end inclusive counted
+    from 0, whose DTW distance to a pattern is within its threshold. */
+struct streamMatch {
+    int pattern;
+    long long start;
+    long long end;
+    double distance;
+};
+
+/* Return a matcher for numPatterns patterns, which are copied. A match of
+    pattern i is reported once its distance is at most thresholds[i] and
+    no overlapping subsequence can still be closer. Each match starts
+    after the end of the pattern's last one, and is the closest such
+    subsequence ending where it does, so its distance is the DTW distance
+    of its samples. Empty patterns never match. */
+struct streamMatcher *newStreamMatcher(double **patterns, int *lengths,
+                                       int numPatterns, double *thresholds);
+
+/* Extend the stream by one sample. The matches this settles are written
+    to matches, which needs room for one per pattern, in order of pattern,
+    and their number is returned. */
+int pushStreamSample(struct streamMatcher *matcher, double sample,
+                     struct streamMatch *matches);
+
+/* End the stream, reporting the matches which were still waiting for a
+    closer overlapping one, as pushStreamSample does. Samples pushed after
+    this start a new stream, whose positions carry on from the old one. */
+int flushStreamMatcher(struct streamMatcher *matcher,
+                       struct streamMatch *matches);
+
+/* Free the matcher and its copies of the patterns. */
+void freeStreamMatcher(struct streamMatcher *matcher);
+
+#endif
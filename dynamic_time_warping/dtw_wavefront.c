@@ -0,0 +1,253 @@
+/*
+    Implementation details for module which contains a vectorised DTW
+    kernel. Cell (i, j) lies on anti-diagonal d = i + j, and reads cells
+    (i - 1, j) and (i, j - 1) from anti-diagonal d - 1 and (i - 1, j - 1)
+    from anti-diagonal d - 2. Each anti-diagonal is stored indexed by i in
+    a skewed layout, and the second sequence is reversed, so every operand
+    of consecutive cells is read from consecutive addresses.
+*/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "dtw_wavefront.h"
+#include "dynamic_time_warping.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define WAVEFRONT_X86
+#endif
+
+#define LDINFINITY (LDBL_MAX / 2.0L)
+#define DINFINITY (DBL_MAX / 2.0)
+
+/* Computes count consecutive cells of an anti-diagonal. For cell k,
+   previous[k] and previous[k + 1] are the insertion and deletion cells,
+   match[k] is the match cell, and sequenceA[k] and sequenceB[k] are the
+   samples it aligns. */
+void diagonalScalar(double *cells, double *previous, double *match,
+                    double *sequenceA, double *sequenceB, int count);
+
+#ifdef WAVEFRONT_X86
+/* Computes cells as diagonalScalar does, four at a time. */
+void diagonalAvx2(double *cells, double *previous, double *match,
+                  double *sequenceA, double *sequenceB, int count);
+
+/* Computes cells as diagonalScalar does, eight at a time. */
+void diagonalAvx512(double *cells, double *previous, double *match,
+                    double *sequenceA, double *sequenceB, int count);
+#endif
+
+/* Sweeps the anti-diagonals with the longer sequence along the columns,
+   so the three anti-diagonals kept are as short as possible. */
+double sweepDiagonals(double *rowSequence, int rows, double *columnSequence,
+                      int columns);
+
+/* Kernel used for every anti-diagonal, chosen on first use. */
+static int selectedKernel = WAVEFRONT_KERNEL_AUTO;
+static void (*diagonalKernel)(double *cells, double *previous, double *match,
+                              double *sequenceA, double *sequenceB,
+                              int count) = NULL;
+
+long double dynamicTimeWarpingWavefront(struct problem *p) {
+    double *sequenceA = (double *)malloc((p->seqALength + 1) * sizeof(double));
+    assert(sequenceA);
+    double *sequenceB = (double *)malloc((p->seqBLength + 1) * sizeof(double));
+    assert(sequenceB);
+    for (int i = 0; i < p->seqALength; i++) {
+        sequenceA[i] = (double)p->sequenceA[i];
+    }
+    for (int j = 0; j < p->seqBLength; j++) {
+        sequenceB[j] = (double)p->sequenceB[j];
+    }
+
+    double distance = wavefrontDistance(sequenceA, p->seqALength, sequenceB,
+                                        p->seqBLength);
+
+    free(sequenceA);
+    free(sequenceB);
+    return distance >= DINFINITY ? LDINFINITY : distance;
+}
+
+double wavefrontDistance(double *sequenceA, int seqALength,
+                         double *sequenceB, int seqBLength) {
+    if (!diagonalKernel) {
+        setWavefrontKernel(selectedKernel);
+    }
+    /* The cost of a cell does not depend on which sequence runs along the
+     * rows, so the matrix can be transposed to index the anti-diagonals by
+     * the shorter sequence. */
+    if (seqALength <= seqBLength) {
+        return sweepDiagonals(sequenceA, seqALength, sequenceB, seqBLength);
+    }
+    return sweepDiagonals(sequenceB, seqBLength, sequenceA, seqALength);
+}
+
+void wavefrontDiagonal(double *cells, double *previous, double *match,
+                       double *sequenceA, double *sequenceB, int count) {
+    if (!diagonalKernel) {
+        setWavefrontKernel(selectedKernel);
+    }
+    diagonalKernel(cells, previous, match, sequenceA, sequenceB, count);
+}
+
+int setWavefrontKernel(int kernel) {
+    int supported = WAVEFRONT_KERNEL_SCALAR;
+#ifdef WAVEFRONT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        supported = WAVEFRONT_KERNEL_AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        supported = WAVEFRONT_KERNEL_AVX2;
+    }
+#endif
+    if (kernel == WAVEFRONT_KERNEL_AUTO || kernel > supported) {
+        kernel = supported;
+    }
+
+    selectedKernel = kernel;
+    switch (kernel) {
+#ifdef WAVEFRONT_X86
+        case WAVEFRONT_KERNEL_AVX512:
+            diagonalKernel = diagonalAvx512;
+            break;
+        case WAVEFRONT_KERNEL_AVX2:
+            diagonalKernel = diagonalAvx2;
+            break;
+#endif
+        default:
+            selectedKernel = WAVEFRONT_KERNEL_SCALAR;
+            diagonalKernel = diagonalScalar;
+            break;
+    }
+    return selectedKernel;
+}
+
+/*
+    Sweeps the anti-diagonals d = 2 to rows + columns. The cells of
+    anti-diagonal d are i = max(1, d - columns) to min(rows, d - 1), and
+    the neighbours read outside that range are the first row and first
+    column of the matrix, index 0 and index d of the anti-diagonal, which
+    are kept at infinity. Anti-diagonal 0 holds only the first cell, 0.
+*/
+double sweepDiagonals(double *rowSequence, int rows, double *columnSequence,
+                      int columns) {
+    if (rows == 0 || columns == 0) {
+        return rows == columns ? 0 : DINFINITY;
+    }
+
+    double *reversed = (double *)malloc(columns * sizeof(double));
+    assert(reversed);
+    for (int j = 0; j < columns; j++) {
+        reversed[j] = columnSequence[columns - 1 - j];
+    }
+
+    /* Anti-diagonals d - 2, d - 1 and d, each with room for index 0 to
+     * rows + 1. */
+    double *diagonals = (double *)malloc(3 * (rows + 2) * sizeof(double));
+    assert(diagonals);
+    for (int c = 0; c < 3 * (rows + 2); c++) {
+        diagonals[c] = DINFINITY;
+    }
+    double *match = diagonals;
+    double *previous = diagonals + (rows + 2);
+    double *cells = diagonals + 2 * (rows + 2);
+    match[0] = 0;
+
+    for (int d = 2; d <= rows + columns; d++) {
+        int first = d - columns > 1 ? d - columns : 1;
+        int last = d - 1 < rows ? d - 1 : rows;
+        /* Cell (i, j) aligns rowSequence[i - 1] with columnSequence[j - 1],
+         * which is reversed[columns - d + i]. */
+        diagonalKernel(cells + first, previous + first - 1, match + first - 1,
+                       rowSequence + first - 1,
+                       reversed + columns - d + first, last - first + 1);
+        /* This buffer last held anti-diagonal d - 3, so the first row and
+         * first column cells next to the new range are reset. */
+        cells[0] = DINFINITY;
+        cells[last + 1] = DINFINITY;
+
+        double *swap = match;
+        match = previous;
+        previous = cells;
+        cells = swap;
+    }
+
+    double distance = previous[rows];
+    free(reversed);
+    free(diagonals);
+    return distance;
+}
+
+void diagonalScalar(double *cells, double *previous, double *match,
+                    double *sequenceA, double *sequenceB, int count) {
+    for (int k = 0; k < count; k++) {
+        double cost = fabs(sequenceA[k] - sequenceB[k]);
+        double best = previous[k] < previous[k + 1] ? previous[k]
+                                                    : previous[k + 1];
+        if (match[k] < best) {
+            best = match[k];
+        }
+        cells[k] = cost + best;
+    }
+}
+
+#ifdef WAVEFRONT_X86
+__attribute__((target("avx2"))) void diagonalAvx2(double *cells,
+                                                  double *previous,
+                                                  double *match,
+                                                  double *sequenceA,
+                                                  double *sequenceB,
+                                                  int count) {
+    /* Clearing the sign bit gives the absolute value. */
+    __m256d signBit = _mm256_set1_pd(-0.0);
+    int k = 0;
+    for (; k + 4 <= count; k += 4) {
+        __m256d cost = _mm256_andnot_pd(
+            signBit, _mm256_sub_pd(_mm256_loadu_pd(sequenceA + k),
+                                   _mm256_loadu_pd(sequenceB + k)));
+        __m256d best = _mm256_min_pd(
+            _mm256_min_pd(_mm256_loadu_pd(previous + k),
+                          _mm256_loadu_pd(previous + k + 1)),
+            _mm256_loadu_pd(match + k));
+        _mm256_storeu_pd(cells + k, _mm256_add_pd(cost, best));
+    }
+    diagonalScalar(cells + k, previous + k, match + k, sequenceA + k,
+                   sequenceB + k, count - k);
+}
+
+__attribute__((target("avx512f"))) void diagonalAvx512(double *cells,
+                                                       double *previous,
+                                                       double *match,
+                                                       double *sequenceA,
+                                                       double *sequenceB,
+                                                       int count) {
+    int k = 0;
+    for (; k + 8 <= count; k += 8) {
+        __m512d cost = _mm512_abs_pd(_mm512_sub_pd(
+            _mm512_loadu_pd(sequenceA + k), _mm512_loadu_pd(sequenceB + k)));
+        __m512d best = _mm512_min_pd(
+            _mm512_min_pd(_mm512_loadu_pd(previous + k),
+                          _mm512_loadu_pd(previous + k + 1)),
+            _mm512_loadu_pd(match + k));
+        _mm512_storeu_pd(cells + k, _mm512_add_pd(cost, best));
+    }
+    /* The remaining cells are masked off rather than left to the scalar
+     * loop, as anti-diagonals near the corners are short. */
+    if (k < count) {
+        __mmask8 mask = (__mmask8)((1u << (count - k)) - 1);
+        __m512d infinity = _mm512_set1_pd(DINFINITY);
+        __m512d cost = _mm512_abs_pd(_mm512_sub_pd(
+            _mm512_maskz_loadu_pd(mask, sequenceA + k),
+            _mm512_maskz_loadu_pd(mask, sequenceB + k)));
+        __m512d best = _mm512_min_pd(
+            _mm512_min_pd(_mm512_mask_loadu_pd(infinity, mask, previous + k),
+                          _mm512_mask_loadu_pd(infinity, mask,
+                                               previous + k + 1)),
+            _mm512_mask_loadu_pd(infinity, mask, match + k));
+        _mm512_mask_storeu_pd(cells + k, mask, _mm512_add_pd(cost, best));
+    }
+}
+#endif
@@ -0,0 +1,46 @@
+/*
+    Header for module which contains a vectorised DTW kernel, which sweeps
+    the cost matrix one anti-diagonal at a time. The cells of an
+    anti-diagonal do not depend on each other, so they are computed in
+    SIMD lanes of doubles.
+*/
+
+#ifndef DTW_WAVEFRONT_H
+#define DTW_WAVEFRONT_H
+
+struct problem;
+
+/* Kernels which can compute the anti-diagonals. AUTO picks the widest one
+    the processor supports when the first distance is computed. */
+#define WAVEFRONT_KERNEL_AUTO (0)
+#define WAVEFRONT_KERNEL_SCALAR (1)
+#define WAVEFRONT_KERNEL_AVX2 (2)
+#define WAVEFRONT_KERNEL_AVX512 (3)
+
+/* Compute the DTW distance of the given problem, as found by
+    dynamicTimeWarping, in double precision. The sequences are rounded to
+    doubles and every kernel returns the same result, which differs from
+    the long double distance by at most (n + m)^2 * 2^-52 * x, where x is
+    the largest magnitude in either sequence. In practice the relative
+    difference is near 1e-15. Memory is linear in the shorter sequence. */
+long double dynamicTimeWarpingWavefront(struct problem *p);
+
+/* Compute the DTW distance between two sequences of doubles, as
+    dynamicTimeWarpingWavefront does. Infinite if exactly one is empty. */
+double wavefrontDistance(double *sequenceA, int seqALength,
+                         double *sequenceB, int seqBLength);
+
+/* Compute count cells of an anti-diagonal with the selected kernel. For
+    cell k, previous[k] and previous[k + 1] are the insertion and deletion
+    cells, match[k] is the match cell, and sequenceA[k] and sequenceB[k]
+    are the samples it aligns. This is the step other sweeps, such as the
+    tiles of tiledDistance, build on. */
+void wavefrontDiagonal(double *cells, double *previous, double *match,
+                       double *sequenceA, double *sequenceB, int count);
+
+/* Select the kernel used by later distances, one of the WAVEFRONT_KERNEL
+    values. A kernel the processor does not support falls back to the
+    widest one it does. Returns the kernel now in use. */
+int setWavefrontKernel(int kernel);
+
+#endif
@@ -15,6 +15,15 @@
 /* Finds the minimum of three values. */
 long double min(long double a, long double b, long double c);
 
+/* Computes the DTW distance with the longer sequence along the rows, so
+    the single row kept is as short as possible. */
+long double rollingDistance(long double *rowSequence, int rows,
+                            long double *columnSequence, int columns);
+
+/* Allocates a band with the given row ranges and room for its widest row. */
+struct warpingBand *newWarpingBand(int seqALength, int seqBLength,
+                                   int *firstColumn, int *lastColumn);
+
 struct solution *dynamicTimeWarping(struct problem *p) {
     struct solution *s = newSolution(p);
     // Initialise the lengths of sequences
@@ -78,18 +87,17 @@ struct solution *dynamicTimeWarpingWithWindow(struct problem *p) {
     }
     s->matrix[0][0] = 0;
 
-    // Populate the DTW matrix
+    // Populate the DTW matrix, visiting only the cells inside the window
     for (int i = 1; i <= n; i++) {
-        for (int j = 1; j <= m; j++) {
-            if (j <= i + p->windowSize && j >= i - p->windowSize) {
-                // Calculate cost using the absolute difference between
-                // sequence points
-                long double cost =
-                    fabsl(p->sequenceA[i - 1] - p->sequenceB[j - 1]);
-                s->matrix[i][j] = cost + min(s->matrix[i - 1][j],  // Insertion
-                                             s->matrix[i][j - 1],  // Deletion
-                                             s->matrix[i - 1][j - 1]);  // Match
-            }
+        int first = i - p->windowSize > 1 ? i - p->windowSize : 1;
+        int last = i + p->windowSize < m ? i + p->windowSize : m;
+        for (int j = first; j <= last; j++) {
+            // Calculate cost using the absolute difference between
+            // sequence points
+            long double cost = fabsl(p->sequenceA[i - 1] - p->sequenceB[j - 1]);
+            s->matrix[i][j] = cost + min(s->matrix[i - 1][j],       // Insertion
+                                         s->matrix[i][j - 1],       // Deletion
+                                         s->matrix[i - 1][j - 1]);  // Match
         }
     }
 
@@ -104,66 +112,267 @@ struct solution *dynamicTimeWarpingWithPathConstraint(struct problem *p) {
     // Initialise the lengths of sequences
     int n = p->seqALength;
     int m = p->seqBLength;
+    int columns = m + 1;
+    size_t layerSize = (size_t)(n + 1) * columns;
 
-    // Create and initialise the DTW matrix with infinity
-    long double ***dtwMatrix = (long double ***)malloc(
-        (p->maximumPathLength + 1) * sizeof(long double **));
-    for (int i = 0; i < p->maximumPathLength + 1; i++) {
-        dtwMatrix[i] = (long double **)malloc((n + 1) * sizeof(long double *));
-        for (int j = 0; j < n + 1; j++) {
-            dtwMatrix[i][j] =
-                (long double *)malloc((m + 1) * sizeof(long double));
-        }
+    /* Layer k of the DTW matrix only reads layer k - 1, so two contiguous
+     * layers are kept and swapped after each path length. Both start as
+     * infinity with the first cell at 0. */
+    long double *previous =
+        (long double *)malloc(2 * layerSize * sizeof(long double));
+    assert(previous);
+    long double *current = previous + layerSize;
+    for (size_t c = 0; c < 2 * layerSize; c++) {
+        previous[c] = LDINFINITY;
     }
-    for (int i = 0; i < p->maximumPathLength + 1; i++) {
-        for (int j = 0; j < n + 1; j++) {
-            for (int k = 0; k < m + 1; k++) {
-                dtwMatrix[i][j][k] = LDINFINITY;
-            }
-        }
-    }
-    for (int i = 0; i < p->maximumPathLength + 1; i++) {
-        dtwMatrix[i][0][0] = 0;
+    previous[0] = 0;
+    current[0] = 0;
+
+    /* The last cell is only computed while i + j + 1 >= k, so later
+     * layers leave it at infinity. */
+    int maximumPathLength = p->maximumPathLength;
+    if (maximumPathLength > n + m + 1) {
+        maximumPathLength = n + m + 1;
     }
 
     long double minimumCost = LDINFINITY;
     // Populate the DTW matrix for each path length
-    for (int k = 1; k <= p->maximumPathLength; k++) {
-        for (int i = 1; i <= n; i++) {
-            for (int j = 1; j <= m; j++) {
-                if (i + j + 1 >= k) {
-                    // Calculate cost using the absolute difference between
-                    // sequence points
-                    long double cost =
-                        fabsl(p->sequenceA[i - 1] - p->sequenceB[j - 1]);
-                    // Insertion
-                    dtwMatrix[k][i][j] =
-                        cost + min(dtwMatrix[k - 1][i - 1][j],
-                                   // Deletion
-                                   dtwMatrix[k - 1][i][j - 1],
-                                   // Match
-                                   dtwMatrix[k - 1][i - 1][j - 1]);
-                }
+    for (int k = 1; k <= maximumPathLength; k++) {
+        /* A cell more than k steps from the first cell in either sequence
+         * cannot be reached in k steps and stays at infinity. A cell more
+         * than the remaining number of layers from the last cell cannot
+         * reach it in time, so it is not computed either. */
+        int remaining = maximumPathLength - k;
+        int lastRow = k < n ? k : n;
+        int firstRow = n - remaining > 1 ? n - remaining : 1;
+        int lastColumn = k < m ? k : m;
+        int reachesLast = m - remaining > 1 ? m - remaining : 1;
+
+        for (int i = 1; i <= lastRow; i++) {
+            long double *row = current + (size_t)i * columns;
+            long double *left = previous + (size_t)i * columns;
+            long double *above = left - columns;
+
+            /* Cells with i + j + 1 < k are infinite in this layer. Its
+             * buffer last held layer k - 2, which computed cells down to
+             * i + j + 1 = k - 2, so those two diagonals are reset. */
+            int diagonal = k - 1 - i;
+            for (int j = diagonal - 2 > 1 ? diagonal - 2 : 1;
+                 j < diagonal && j <= m; j++) {
+                row[j] = LDINFINITY;
+            }
+            if (i < firstRow) {
+                continue;
+            }
+
+            int first = diagonal > reachesLast ? diagonal : reachesLast;
+            for (int j = first; j <= lastColumn; j++) {
+                // Calculate cost using the absolute difference between
+                // sequence points
+                long double cost =
+                    fabsl(p->sequenceA[i - 1] - p->sequenceB[j - 1]);
+                row[j] = cost + min(above[j],       // Insertion
+                                    left[j - 1],    // Deletion
+                                    above[j - 1]);  // Match
             }
         }
         // At each iteration, check if the current minimum is the optimal
         // value of all path lengths
-        if (dtwMatrix[k][n][m] <= minimumCost) {
-            minimumCost = dtwMatrix[k][n][m];
+        if (current[layerSize - 1] <= minimumCost) {
+            minimumCost = current[layerSize - 1];
         }
-    }
 
-    // Free the 3D DTW Matrix
-    for (int i = 0; i < p->maximumPathLength + 1; i++) {
-        for (int j = 0; j < n + 1; j++) {
-            free(dtwMatrix[i][j]);
-        }
-        free(dtwMatrix[i]);
+        long double *swap = previous;
+        previous = current;
+        current = swap;
     }
-    free(dtwMatrix);
 
-    // The DTW distance is in the bottom-right corner of the matrix
+    free(previous < current ? previous : current);
+
+    // The DTW distance is the least cost of the last cell over all path
+    // lengths
     s->optimalValue = minimumCost;
 
     return s;
-}
\ No newline at end of file
+}
+
+long double dynamicTimeWarpingCost(struct problem *p) {
+    return dynamicTimeWarpingDistance(p->sequenceA, p->seqALength,
+                                      p->sequenceB, p->seqBLength);
+}
+
+long double dynamicTimeWarpingDistance(long double *sequenceA, int seqALength,
+                                       long double *sequenceB,
+                                       int seqBLength) {
+    /* The cost of a cell does not depend on which sequence runs along the
+     * rows, so the matrix can be transposed to keep the shorter row. */
+    if (seqALength >= seqBLength) {
+        return rollingDistance(sequenceA, seqALength, sequenceB, seqBLength);
+    }
+    return rollingDistance(sequenceB, seqBLength, sequenceA, seqALength);
+}
+
+/*
+    Computes the DTW distance keeping a single row of the matrix. Before
+    row i is computed, row[j] holds cell (i - 1, j), and each cell is
+    overwritten with (i, j) once read, so only the match cell (i - 1,
+    j - 1) needs to be kept aside.
+*/
+long double rollingDistance(long double *rowSequence, int rows,
+                            long double *columnSequence, int columns) {
+    long double *row =
+        (long double *)malloc((columns + 1) * sizeof(long double));
+    assert(row);
+    row[0] = 0;
+    for (int j = 1; j <= columns; j++) {
+        row[j] = LDINFINITY;
+    }
+
+    for (int i = 1; i <= rows; i++) {
+        long double match = row[0];
+        row[0] = LDINFINITY;
+        for (int j = 1; j <= columns; j++) {
+            long double cost =
+                fabsl(rowSequence[i - 1] - columnSequence[j - 1]);
+            long double insertion = row[j];
+            row[j] = cost + min(insertion, row[j - 1], match);
+            match = insertion;
+        }
+    }
+
+    long double distance = row[columns];
+    free(row);
+    return distance;
+}
+
+struct warpingBand *newSakoeChibaBand(int seqALength, int seqBLength,
+                                      int windowSize) {
+    int *firstColumn = (int *)malloc((seqALength + 1) * sizeof(int));
+    assert(firstColumn);
+    int *lastColumn = (int *)malloc((seqALength + 1) * sizeof(int));
+    assert(lastColumn);
+
+    for (int i = 1; i <= seqALength; i++) {
+        firstColumn[i] = i - windowSize > 1 ? i - windowSize : 1;
+        lastColumn[i] = i + windowSize < seqBLength ? i + windowSize
+                                                    : seqBLength;
+    }
+
+    return newWarpingBand(seqALength, seqBLength, firstColumn, lastColumn);
+}
+
+struct warpingBand *newItakuraBand(int seqALength, int seqBLength,
+                                   double maximumSlope) {
+    int *firstColumn = (int *)malloc((seqALength + 1) * sizeof(int));
+    assert(firstColumn);
+    int *lastColumn = (int *)malloc((seqALength + 1) * sizeof(int));
+    assert(lastColumn);
+
+    /* Measured from (1, 1), cell (i, j) must lie between the lines of
+     * slope maximumSlope and 1 / maximumSlope through the first cell,
+     * and between the lines of the same slopes through the last cell
+     * (n, m). The small tolerance keeps cells exactly on a line that
+     * division rounds to just outside it. */
+    long double slope = maximumSlope < 1 ? 1 : maximumSlope;
+    long double tolerance = 1e-9L;
+    for (int i = 1; i <= seqALength; i++) {
+        long double x = i - 1;
+        long double remaining = seqALength - i;
+        long double fromStart = ceill(x / slope - tolerance);
+        long double fromEnd = (seqBLength - 1) - floorl(remaining * slope +
+                                                        tolerance);
+        long double toStart = floorl(x * slope + tolerance);
+        long double toEnd = (seqBLength - 1) - ceill(remaining / slope -
+                                                     tolerance);
+        long double first = fromStart > fromEnd ? fromStart : fromEnd;
+        long double last = toStart < toEnd ? toStart : toEnd;
+        firstColumn[i] = first < 0 ? 1 : (int)first + 1;
+        lastColumn[i] = last >= seqBLength ? seqBLength : (int)last + 1;
+    }
+
+    return newWarpingBand(seqALength, seqBLength, firstColumn, lastColumn);
+}
+
+long double dynamicTimeWarpingInBand(struct problem *p,
+                                     struct warpingBand *band) {
+    assert(band->seqALength == p->seqALength &&
+           band->seqBLength == p->seqBLength);
+    int n = p->seqALength;
+    band->cells[0] = 0;
+
+    for (int i = 1; i <= n; i++) {
+        long double *row = band->cells + (size_t)i * band->stride;
+        int first = band->firstColumn[i];
+        int last = band->lastColumn[i];
+        /* The cell left of the first one is outside the band. */
+        long double previous = LDINFINITY;
+        for (int j = first; j <= last; j++) {
+            // Calculate cost using the absolute difference between
+            // sequence points
+            long double cost = fabsl(p->sequenceA[i - 1] - p->sequenceB[j - 1]);
+            // Insertion
+            previous = cost + min(warpingBandCell(band, i - 1, j),
+                                  // Deletion
+                                  previous,
+                                  // Match
+                                  warpingBandCell(band, i - 1, j - 1));
+            row[j - first] = previous;
+        }
+    }
+
+    band->optimalValue = warpingBandCell(band, n, p->seqBLength);
+    return band->optimalValue;
+}
+
+long double warpingBandCell(struct warpingBand *band, int i, int j) {
+    if (j < band->firstColumn[i] || j > band->lastColumn[i]) {
+        return LDINFINITY;
+    }
+    return band->cells[(size_t)i * band->stride + (j - band->firstColumn[i])];
+}
+
+void freeWarpingBand(struct warpingBand *band) {
+    if (!band) {
+        return;
+    }
+    free(band->firstColumn);
+    free(band->lastColumn);
+    free(band->cells);
+    free(band);
+}
+
+/*
+    Allocates a band over the given row ranges, which it takes ownership
+    of. Row 0 is set to hold only the first cell (0, 0), and an empty
+    row is normalised so its last column is below its first.
+*/
+struct warpingBand *newWarpingBand(int seqALength, int seqBLength,
+                                   int *firstColumn, int *lastColumn) {
+    struct warpingBand *band =
+        (struct warpingBand *)malloc(sizeof(struct warpingBand));
+    assert(band);
+    band->seqALength = seqALength;
+    band->seqBLength = seqBLength;
+    band->firstColumn = firstColumn;
+    band->lastColumn = lastColumn;
+    band->optimalValue = LDINFINITY;
+
+    firstColumn[0] = 0;
+    lastColumn[0] = 0;
+    int stride = 1;
+    for (int i = 1; i <= seqALength; i++) {
+        if (lastColumn[i] < firstColumn[i]) {
+            lastColumn[i] = firstColumn[i] - 1;
+        }
+        if (lastColumn[i] - firstColumn[i] + 1 > stride) {
+            stride = lastColumn[i] - firstColumn[i] + 1;
+        }
+    }
+    band->stride = stride;
+
+    band->cells = (long double *)malloc((size_t)(seqALength + 1) * stride *
+                                        sizeof(long double));
+    assert(band->cells);
+
+    return band;
+}
@@ -1,7 +1,67 @@
 #include <stdio.h>
 
+/* The cells of the DTW matrix allowed by a window constraint, stored
+    row by row without the cells outside it. */
+struct warpingBand {
+    int seqALength;
+    int seqBLength;
+    /* Row i holds the cells (i, j) for firstColumn[i] <= j <=
+        lastColumn[i], and is empty if lastColumn[i] < firstColumn[i].
+        Row 0 holds only the first cell (0, 0). */
+    int *firstColumn;
+    int *lastColumn;
+    /* The cells of row i start at cells + i * stride, where stride is the
+        width of the widest row, 2w + 1 for a Sakoe-Chiba window of w. */
+    int stride;
+    long double *cells;
+    /* Cost of the last cell (n, m), once computed. */
+    long double optimalValue;
+};
+
 struct solution *dynamicTimeWarping(struct problem *p);
 
+/* Perform DTW with a Sakoe-Chiba window of windowSize cells either side
+    of the diagonal. Only the cells inside the window are computed, but
+    the full matrix of the solution is still initialised. */
 struct solution *dynamicTimeWarpingWithWindow(struct problem *p);
 
-struct solution *dynamicTimeWarpingWithPathConstraint(struct problem *p);
\ No newline at end of file
+struct solution *dynamicTimeWarpingWithPathConstraint(struct problem *p);
+
+/* Compute only the DTW distance of the given problem, as found by
+    dynamicTimeWarping, without allocating a solution or its cost matrix.
+    A single row of min(n, m) + 1 cells is kept, so memory is linear. */
+long double dynamicTimeWarpingCost(struct problem *p);
+
+/* Compute the DTW distance between two sequences, as
+    dynamicTimeWarpingCost does, without a problem. */
+long double dynamicTimeWarpingDistance(long double *sequenceA, int seqALength,
+                                       long double *sequenceB,
+                                       int seqBLength);
+
+/* Create a band holding the Sakoe-Chiba window of windowSize cells
+    either side of the diagonal, the window of
+    dynamicTimeWarpingWithWindow, in (n + 1) x (2 windowSize + 1) cells. */
+struct warpingBand *newSakoeChibaBand(int seqALength, int seqBLength,
+                                      int windowSize);
+
+/* Create a band holding the Itakura parallelogram, the cells a path from
+    (1, 1) to (n, m) can reach when its overall slope stays between
+    1 / maximumSlope and maximumSlope, which must be at least 1. The
+    band is empty if the sequence lengths differ by more than that
+    slope allows. */
+struct warpingBand *newItakuraBand(int seqALength, int seqBLength,
+                                   double maximumSlope);
+
+/* Perform DTW over the cells of a band created for the lengths of the
+    given problem, visiting only those cells, so time and memory are
+    linear in the size of the band. The costs are left in the band and
+    the DTW distance is returned, or infinity if no path fits it. */
+long double dynamicTimeWarpingInBand(struct problem *p,
+                                     struct warpingBand *band);
+
+/* Return the cost of cell (i, j) of a computed band, or infinity if the
+    cell is outside it. */
+long double warpingBandCell(struct warpingBand *band, int i, int j);
+
+/* Free a band and its cells. */
+void freeWarpingBand(struct warpingBand *band);
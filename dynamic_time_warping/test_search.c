@@ -0,0 +1,213 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "problem.h"
+#include "dynamic_time_warping.h"
+#include "dtw_search.h"
+
+/* Series searched, and the samples of each. */
+#define SERIES_COUNT 60
+#define SERIES_LENGTH 300
+
+/* Queries have between these many samples, and searches ask for up to
+   this many matches. */
+#define MINIMUM_QUERY_LENGTH 8
+#define MAXIMUM_QUERY_LENGTH 60
+#define MAXIMUM_MATCHES 6
+
+/* The search normalises with running sums and computes in double precision,
+   so distances are compared to within this, relative to their size. */
+#define TOLERANCE 1e-6
+
+/* Returns the next value of a xorshift generator, so series only depend on
+   the seed and not on the C library. */
+unsigned long long nextRandom(unsigned long long *state);
+
+/* Returns a uniform random number in [-1, 1). */
+double randomStep(unsigned long long *state);
+
+/* Copies a sequence into a problem sequence, z-normalised if asked, as
+   searchSubsequences normalises the query and each subsequence. */
+void copyNormalised(double *source, int length, int normalise,
+                    long double *target);
+
+/* Finds the k matches of a query in a series by computing the distance of
+   every subsequence with dynamicTimeWarpingWithWindow and choosing them
+   closest first, skipping trivial matches. Returns their number. */
+int bruteForceMatches(double *query, int queryLength, double *series,
+                      int seriesLength, int windowSize, int normalise, int k,
+                      struct searchResult *results);
+
+/* Frees a solution from newSolution, whose matrix rows are allocated one
+   by one. */
+void freeSolution(struct problem *p, struct solution *s);
+
+int main(int argc, char **argv) {
+    unsigned long long seed = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+    unsigned long long state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    double *series = (double *)malloc(SERIES_LENGTH * sizeof(double));
+    double *query = (double *)malloc(MAXIMUM_QUERY_LENGTH * sizeof(double));
+    struct searchResult found[MAXIMUM_MATCHES];
+    struct searchResult expected[MAXIMUM_MATCHES];
+
+    int failures = 0;
+    for (int s = 0; s < SERIES_COUNT; s++) {
+        /* Random walks, with a query taken from the series and perturbed,
+         * so that its neighbourhood holds many close matches. */
+        series[0] = 0;
+        for (int t = 1; t < SERIES_LENGTH; t++) {
+            series[t] = series[t - 1] + randomStep(&state);
+        }
+        int queryLength =
+            MINIMUM_QUERY_LENGTH +
+            nextRandom(&state) %
+                (MAXIMUM_QUERY_LENGTH - MINIMUM_QUERY_LENGTH + 1);
+        int from = nextRandom(&state) % (SERIES_LENGTH - queryLength + 1);
+        for (int i = 0; i < queryLength; i++) {
+            query[i] = series[from + i] + 0.5 * randomStep(&state);
+        }
+        int windowSize = nextRandom(&state) % (queryLength / 4 + 1);
+        int normalise = nextRandom(&state) % 2;
+        int k = 1 + nextRandom(&state) % MAXIMUM_MATCHES;
+
+        int numFound =
+            searchSubsequences(query, queryLength, series, SERIES_LENGTH,
+                               windowSize, normalise, k, found, NULL);
+        int numExpected =
+            bruteForceMatches(query, queryLength, series, SERIES_LENGTH,
+                              windowSize, normalise, k, expected);
+        int same = numFound == numExpected;
+        for (int r = 0; same && r < numFound; r++) {
+            same = found[r].position == expected[r].position &&
+                   fabs(found[r].distance - expected[r].distance) <=
+                       TOLERANCE * (1 + expected[r].distance);
+        }
+        if (!same) {
+            printf("series %d (length %d, window %d, normalise %d, k %d):\n",
+                   s, queryLength, windowSize, normalise, k);
+            for (int r = 0; r < numFound || r < numExpected; r++) {
+                printf("  %d: ", r);
+                if (r < numFound) {
+                    printf("found %lld at %g", found[r].position,
+                           found[r].distance);
+                }
+                if (r < numExpected) {
+                    printf("%sexpected %lld at %g", r < numFound ? ", " : "",
+                           expected[r].position, expected[r].distance);
+                }
+                printf("\n");
+            }
+            failures++;
+        }
+    }
+
+    printf("%d searches, %d failures\n", SERIES_COUNT, failures);
+    free(series);
+    free(query);
+    return failures > 0 ? 1 : 0;
+}
+
+unsigned long long nextRandom(unsigned long long *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+double randomStep(unsigned long long *state) {
+    return (double)(nextRandom(state) >> 11) / (double)(1ULL << 52) - 1.0;
+}
+
+void copyNormalised(double *source, int length, int normalise,
+                    long double *target) {
+    long double mean = 0;
+    long double deviation = 1;
+    if (normalise) {
+        for (int i = 0; i < length; i++) {
+            mean += source[i];
+        }
+        mean /= length;
+        long double squares = 0;
+        for (int i = 0; i < length; i++) {
+            squares += (source[i] - mean) * (source[i] - mean);
+        }
+        if (squares > 0) {
+            deviation = sqrtl(squares / length);
+        }
+    }
+    for (int i = 0; i < length; i++) {
+        target[i] = (source[i] - mean) / deviation;
+    }
+}
+
+/*
+    Every subsequence is a candidate, and a candidate is chosen unless one
+    already chosen, which is closer, starts less than half the query length
+    from it. This is what searchSubsequences must return however its
+    bounds prune the candidates.
+*/
+int bruteForceMatches(double *query, int queryLength, double *series,
+                      int seriesLength, int windowSize, int normalise, int k,
+                      struct searchResult *results) {
+    int count = seriesLength - queryLength + 1;
+    struct searchResult *all =
+        (struct searchResult *)malloc(count * sizeof(struct searchResult));
+    struct problem p;
+    p.seqALength = queryLength;
+    p.seqBLength = queryLength;
+    p.sequenceA =
+        (long double *)malloc((queryLength + 1) * sizeof(long double));
+    p.sequenceB =
+        (long double *)malloc((queryLength + 1) * sizeof(long double));
+    p.windowSize = windowSize;
+    p.maximumPathLength = 0;
+    copyNormalised(query, queryLength, normalise, p.sequenceA);
+    for (int start = 0; start < count; start++) {
+        copyNormalised(series + start, queryLength, normalise, p.sequenceB);
+        struct solution *s = dynamicTimeWarpingWithWindow(&p);
+        all[start].position = start;
+        all[start].distance = (double)s->optimalValue;
+        freeSolution(&p, s);
+    }
+
+    /* Choose closest first; the tests use continuous samples, so
+     * distances do not tie. */
+    int numResults = 0;
+    while (numResults < k) {
+        int best = -1;
+        for (int c = 0; c < count; c++) {
+            if (all[c].position < 0 ||
+                (best >= 0 && all[c].distance >= all[best].distance)) {
+                continue;
+            }
+            best = c;
+        }
+        if (best < 0) {
+            break;
+        }
+        results[numResults++] = all[best];
+        /* Rule out the one chosen and its trivial matches. */
+        long long chosen = all[best].position;
+        all[best].position = -1;
+        for (int c = 0; c < count; c++) {
+            if (all[c].position >= 0 &&
+                llabs(all[c].position - chosen) < queryLength / 2) {
+                all[c].position = -1;
+            }
+        }
+    }
+
+    free(all);
+    free(p.sequenceA);
+    free(p.sequenceB);
+    return numResults;
+}
+
+void freeSolution(struct problem *p, struct solution *s) {
+    for (int i = 0; i <= p->seqALength; i++) {
+        free(s->matrix[i]);
+    }
+    free(s->matrix);
+    free(s);
+}
@@ -0,0 +1,184 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "problem.h"
+#include "dynamic_time_warping.h"
+#include "dtw_stream.h"
+
+/* Streams checked, and the samples of each. */
+#define STREAM_COUNT 200
+#define STREAM_LENGTH 400
+
+/* Patterns matched against each stream, of up to this many samples. */
+#define PATTERN_COUNT 6
+#define MAXIMUM_PATTERN_LENGTH 12
+
+/* Distances are computed in double precision by the matcher and in long
+   double by dynamicTimeWarping, so they are compared to within this. */
+#define TOLERANCE 1e-9
+
+/* Returns the next value of a xorshift generator, so streams only depend
+   on the seed and not on the C library. */
+unsigned long long nextRandom(unsigned long long *state);
+
+/* Returns the DTW distance of a pattern to the samples start to end
+   inclusive of a stream, from dynamicTimeWarping. */
+long double subsequenceDistance(double *pattern, int patternLength,
+                                double *stream, long long start,
+                                long long end);
+
+/* Checks a reported match against the subsequences of the stream, given
+   the end of the previous match of its pattern, and returns the number of
+   failures, printing each. */
+int checkMatch(struct streamMatch *match, double **patterns, int *lengths,
+               double *thresholds, double *stream, long long previousEnd,
+               int streamIndex);
+
+/* Frees a solution from newSolution, whose matrix rows are allocated one
+   by one. */
+void freeSolution(struct problem *p, struct solution *s);
+
+int main(int argc, char **argv) {
+    unsigned long long seed = argc > 1 ? strtoull(argv[1], NULL, 10) : 1;
+    unsigned long long state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    double *stream = (double *)malloc(STREAM_LENGTH * sizeof(double));
+    double *patterns[PATTERN_COUNT];
+    int lengths[PATTERN_COUNT];
+    double thresholds[PATTERN_COUNT];
+    long long previousEnds[PATTERN_COUNT];
+    struct streamMatch matches[PATTERN_COUNT];
+    for (int k = 0; k < PATTERN_COUNT; k++) {
+        patterns[k] =
+            (double *)malloc(MAXIMUM_PATTERN_LENGTH * sizeof(double));
+    }
+
+    int failures = 0;
+    long long reported = 0;
+    for (int s = 0; s < STREAM_COUNT; s++) {
+        /* Small integer samples make many paths tie, which is where the
+         * start a cell keeps matters. */
+        for (int t = 0; t < STREAM_LENGTH; t++) {
+            stream[t] = (double)(nextRandom(&state) % 5);
+        }
+        for (int k = 0; k < PATTERN_COUNT; k++) {
+            lengths[k] = 1 + nextRandom(&state) % MAXIMUM_PATTERN_LENGTH;
+            for (int i = 0; i < lengths[k]; i++) {
+                patterns[k][i] = (double)(nextRandom(&state) % 5);
+            }
+            thresholds[k] = (double)(nextRandom(&state) % (2 * lengths[k]));
+            previousEnds[k] = -1;
+        }
+
+        struct streamMatcher *matcher =
+            newStreamMatcher(patterns, lengths, PATTERN_COUNT, thresholds);
+        for (int t = 0; t <= STREAM_LENGTH; t++) {
+            int count = t < STREAM_LENGTH
+                            ? pushStreamSample(matcher, stream[t], matches)
+                            : flushStreamMatcher(matcher, matches);
+            for (int c = 0; c < count; c++) {
+                int k = matches[c].pattern;
+                failures += checkMatch(&matches[c], patterns, lengths,
+                                       thresholds, stream, previousEnds[k], s);
+                previousEnds[k] = matches[c].end;
+            }
+            reported += count;
+        }
+        freeStreamMatcher(matcher);
+    }
+
+    printf("%lld matches in %d streams, %d failures\n", reported,
+           STREAM_COUNT, failures);
+    for (int k = 0; k < PATTERN_COUNT; k++) {
+        free(patterns[k]);
+    }
+    free(stream);
+    return failures > 0 ? 1 : 0;
+}
+
+unsigned long long nextRandom(unsigned long long *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+long double subsequenceDistance(double *pattern, int patternLength,
+                                double *stream, long long start,
+                                long long end) {
+    struct problem p;
+    p.seqALength = patternLength;
+    p.seqBLength = (int)(end - start + 1);
+    p.sequenceA =
+        (long double *)malloc((p.seqALength + 1) * sizeof(long double));
+    p.sequenceB =
+        (long double *)malloc((p.seqBLength + 1) * sizeof(long double));
+    for (int i = 0; i < p.seqALength; i++) {
+        p.sequenceA[i] = pattern[i];
+    }
+    for (int j = 0; j < p.seqBLength; j++) {
+        p.sequenceB[j] = stream[start + j];
+    }
+    p.windowSize = 0;
+    p.maximumPathLength = 0;
+
+    struct solution *s = dynamicTimeWarping(&p);
+    long double distance = s->optimalValue;
+    freeSolution(&p, s);
+    free(p.sequenceA);
+    free(p.sequenceB);
+    return distance;
+}
+
+/*
+    A match must be within its threshold and start after the previous match
+    of its pattern, and its distance must be that of its samples. It must
+    also be the closest subsequence ending where it does and starting after
+    the previous match, which is what goes wrong when paths that only lost
+    to one overlapping the previous match are dropped.
+*/
+int checkMatch(struct streamMatch *match, double **patterns, int *lengths,
+               double *thresholds, double *stream, long long previousEnd,
+               int streamIndex) {
+    int k = match->pattern;
+    int failures = 0;
+    if (match->start <= previousEnd || match->end < match->start ||
+        match->end >= STREAM_LENGTH || match->distance > thresholds[k]) {
+        printf("stream %d pattern %d: match %lld to %lld at %g is out of "
+               "place\n",
+               streamIndex, k, match->start, match->end, match->distance);
+        return 1;
+    }
+
+    long double exact = subsequenceDistance(patterns[k], lengths[k], stream,
+                                            match->start, match->end);
+    if (fabsl(exact - match->distance) > TOLERANCE) {
+        printf("stream %d pattern %d: match %lld to %lld reported %g, DTW "
+               "%Lg\n",
+               streamIndex, k, match->start, match->end, match->distance,
+               exact);
+        failures++;
+    }
+
+    for (long long start = previousEnd + 1; start <= match->end; start++) {
+        long double distance = subsequenceDistance(
+            patterns[k], lengths[k], stream, start, match->end);
+        if (distance < match->distance - TOLERANCE) {
+            printf("stream %d pattern %d: match %lld to %lld reported %g, "
+                   "but from %lld DTW is %Lg\n",
+                   streamIndex, k, match->start, match->end, match->distance,
+                   start, distance);
+            failures++;
+            break;
+        }
+    }
+    return failures;
+}
+
+void freeSolution(struct problem *p, struct solution *s) {
+    for (int i = 0; i <= p->seqALength; i++) {
+        free(s->matrix[i]);
+    }
+    free(s->matrix);
+    free(s);
+}